@@ -0,0 +1,259 @@
+// Packs sprite sheets into one texture atlas at build time. Every sheet is
+// cut into its grid cells, identical cells are stored once, and the cells
+// are shelf packed with an extruded border so filtering never samples a
+// neighbour. Besides the atlas PNG it writes a header of constexpr UV
+// rectangles, so the game never derives texture coordinates at runtime.
+//
+//   atlas_packer OUT.png OUT.h NAME=SHEET.png:COLUMNSxROWS...
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <zlib.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "utils/image.cpp"
+
+using namespace std;
+
+struct Sheet
+{
+  string name;
+  string path;
+  int columns = 1, rows = 1;
+  vector<int> cellSprites; // Sprite index per grid cell, row major
+};
+
+struct Sprite
+{
+  int width, height;
+  vector<unsigned char> pixels;
+  int x = 0, y = 0; // Interior position in the atlas
+};
+
+const int padding = 2;
+
+bool parseSheet(const string &arg, Sheet &sheet)
+{
+  size_t equals = arg.find('=');
+  size_t colon = arg.rfind(':');
+  if (equals == string::npos || colon == string::npos || colon < equals)
+    return false;
+  sheet.name = arg.substr(0, equals);
+  sheet.path = arg.substr(equals + 1, colon - equals - 1);
+  return sscanf(arg.c_str() + colon + 1, "%dx%d", &sheet.columns, &sheet.rows) == 2 && sheet.columns > 0 && sheet.rows > 0;
+}
+
+// Shelf packing into a fixed width, tallest sprites first. Returns the used
+// height or -1 when a sprite is wider than the atlas.
+int packShelves(vector<Sprite> &sprites, int atlasWidth)
+{
+  vector<int> order(sprites.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  stable_sort(order.begin(), order.end(), [&](int a, int b) { return sprites[a].height > sprites[b].height; });
+
+  int penX = 0, shelfY = 0, shelfHeight = 0;
+  for (int index : order)
+  {
+    Sprite &sprite = sprites[index];
+    int width = sprite.width + 2 * padding;
+    int height = sprite.height + 2 * padding;
+    if (width > atlasWidth)
+      return -1;
+    if (penX + width > atlasWidth)
+    {
+      shelfY += shelfHeight;
+      penX = 0;
+      shelfHeight = 0;
+    }
+    sprite.x = penX + padding;
+    sprite.y = shelfY + padding;
+    penX += width;
+    shelfHeight = max(shelfHeight, height);
+  }
+  return shelfY + shelfHeight;
+}
+
+// Copies the sprite and repeats its edge pixels into the padding
+void blitExtruded(vector<unsigned char> &atlas, int atlasWidth, const Sprite &sprite)
+{
+  for (int y = -padding; y < sprite.height + padding; ++y)
+  {
+    int sy = min(max(y, 0), sprite.height - 1);
+    for (int x = -padding; x < sprite.width + padding; ++x)
+    {
+      int sx = min(max(x, 0), sprite.width - 1);
+      const unsigned char *src = &sprite.pixels[((size_t)sy * sprite.width + sx) * 4];
+      unsigned char *dst = &atlas[((size_t)(sprite.y + y) * atlasWidth + sprite.x + x) * 4];
+      copy(src, src + 4, dst);
+    }
+  }
+}
+
+// The atlas ships with the game, so unlike capture frames it is deflated
+bool writeCompressedPNG(const string &path, const vector<unsigned char> &rgba, int width, int height)
+{
+  vector<unsigned char> raw;
+  size_t stride = (size_t)width * 4;
+  raw.reserve((stride + 1) * height);
+  for (int y = 0; y < height; ++y)
+  {
+    raw.push_back(0);
+    raw.insert(raw.end(), rgba.begin() + y * stride, rgba.begin() + (y + 1) * stride);
+  }
+  uLongf compressedSize = compressBound(raw.size());
+  vector<unsigned char> idat(compressedSize);
+  if (compress2(idat.data(), &compressedSize, raw.data(), raw.size(), Z_BEST_COMPRESSION) != Z_OK)
+    return false;
+  idat.resize(compressedSize);
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  fwrite(signature, 1, 8, file);
+  vector<unsigned char> ihdr = {(unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+                                (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+                                8, 6, 0, 0, 0};
+  writePNGChunk(file, "IHDR", ihdr);
+  writePNGChunk(file, "IDAT", idat);
+  writePNGChunk(file, "IEND", {});
+  fclose(file);
+  return true;
+}
+
+bool writeHeader(const string &path, const string &atlasPath, const vector<Sheet> &sheets, const vector<Sprite> &sprites, int atlasWidth, int atlasHeight)
+{
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+
+  fprintf(file, "// Generated by atlas_packer for %s, run `make atlas` instead of editing.\n", atlasPath.c_str());
+  fprintf(file, "// Sources:");
+  for (const Sheet &sheet : sheets)
+    fprintf(file, " %s (%dx%d)", sheet.path.c_str(), sheet.columns, sheet.rows);
+  fprintf(file, "\n\n#pragma once\n\n");
+  fprintf(file, "// Texture coordinates of one sprite, v runs from the top row down\n");
+  fprintf(file, "struct AtlasRect\n{\n  float u1, v1, u2, v2;\n};\n\n");
+  fprintf(file, "constexpr int atlasWidth = %d;\nconstexpr int atlasHeight = %d;\n", atlasWidth, atlasHeight);
+
+  for (const Sheet &sheet : sheets)
+  {
+    fprintf(file, "\n// %s, row major\n", sheet.path.c_str());
+    fprintf(file, "constexpr int %sColumns = %d;\n", sheet.name.c_str(), sheet.columns);
+    fprintf(file, "constexpr int %sRows = %d;\n", sheet.name.c_str(), sheet.rows);
+    fprintf(file, "constexpr AtlasRect %sRects[%d] = {\n", sheet.name.c_str(), sheet.columns * sheet.rows);
+    for (int index : sheet.cellSprites)
+    {
+      const Sprite &sprite = sprites[index];
+      fprintf(file, "    {%.9gf, %.9gf, %.9gf, %.9gf},\n", (double)sprite.x / atlasWidth, (double)sprite.y / atlasHeight,
+              (double)(sprite.x + sprite.width) / atlasWidth, (double)(sprite.y + sprite.height) / atlasHeight);
+    }
+    fprintf(file, "};\n");
+  }
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 4)
+  {
+    cerr << "usage: atlas_packer OUT.png OUT.h NAME=SHEET.png:COLUMNSxROWS..." << endl;
+    return 1;
+  }
+  string atlasPath = argv[1];
+  string headerPath = argv[2];
+
+  vector<Sheet> sheets;
+  vector<Sprite> sprites;
+  map<vector<unsigned char>, int> spriteIndex;
+  for (int i = 3; i < argc; ++i)
+  {
+    Sheet sheet;
+    if (!parseSheet(argv[i], sheet))
+    {
+      cerr << "Bad sheet " << argv[i] << ", expected NAME=SHEET.png:COLUMNSxROWS" << endl;
+      return 1;
+    }
+
+    int width, height, channels;
+    unsigned char *image = stbi_load(sheet.path.c_str(), &width, &height, &channels, 4);
+    if (!image)
+    {
+      cerr << "Failed to load " << sheet.path << endl;
+      return 1;
+    }
+
+    int cellWidth = width / sheet.columns;
+    int cellHeight = height / sheet.rows;
+    for (int row = 0; row < sheet.rows; ++row)
+    {
+      for (int column = 0; column < sheet.columns; ++column)
+      {
+        // Keyed by size and pixels, blank glyphs and repeated tiles are packed once
+        vector<unsigned char> key = {(unsigned char)(cellWidth >> 8), (unsigned char)cellWidth, (unsigned char)(cellHeight >> 8), (unsigned char)cellHeight};
+        for (int y = 0; y < cellHeight; ++y)
+        {
+          const unsigned char *src = image + ((size_t)(row * cellHeight + y) * width + column * cellWidth) * 4;
+          key.insert(key.end(), src, src + cellWidth * 4);
+        }
+        auto found = spriteIndex.find(key);
+        if (found == spriteIndex.end())
+        {
+          Sprite sprite;
+          sprite.width = cellWidth;
+          sprite.height = cellHeight;
+          sprite.pixels.assign(key.begin() + 4, key.end());
+          found = spriteIndex.insert({key, (int)sprites.size()}).first;
+          sprites.push_back(sprite);
+        }
+        sheet.cellSprites.push_back(found->second);
+      }
+    }
+    stbi_image_free(image);
+    sheets.push_back(sheet);
+  }
+
+  // Smallest power of two square-ish atlas that fits
+  int atlasWidth = 64, atlasHeight = 0;
+  while (true)
+  {
+    int used = packShelves(sprites, atlasWidth);
+    if (used >= 0)
+    {
+      atlasHeight = 1;
+      while (atlasHeight < used)
+        atlasHeight <<= 1;
+      if (atlasHeight <= atlasWidth)
+        break;
+    }
+    atlasWidth <<= 1;
+  }
+
+  vector<unsigned char> atlas((size_t)atlasWidth * atlasHeight * 4, 0);
+  for (const Sprite &sprite : sprites)
+    blitExtruded(atlas, atlasWidth, sprite);
+
+  if (!writeCompressedPNG(atlasPath, atlas, atlasWidth, atlasHeight))
+  {
+    cerr << "Could not write " << atlasPath << endl;
+    return 1;
+  }
+  if (!writeHeader(headerPath, atlasPath, sheets, sprites, atlasWidth, atlasHeight))
+  {
+    cerr << "Could not write " << headerPath << endl;
+    return 1;
+  }
+
+  size_t cells = 0;
+  for (const Sheet &sheet : sheets)
+    cells += sheet.cellSprites.size();
+  cout << atlasPath << ": " << atlasWidth << "x" << atlasHeight << ", " << sprites.size() << " sprites for " << cells << " cells" << endl;
+  return 0;
+}
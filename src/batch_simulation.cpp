@@ -0,0 +1,210 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "simulation.cpp"
+#include "utils/triple_buffer.cpp"
+
+using namespace std;
+
+// Every board of a batch in one image. Board i is a columns x rows tile of
+// CellState bytes, tiles are laid out gridColumns wide from the top left
+// and rows are stored bottom up, like a texture.
+struct WallSnapshot
+{
+  uint64_t sequence = 0;
+  int boards = 0;
+  int gridColumns = 0, gridRows = 0;
+  int columns = 0, rows = 0;
+  vector<unsigned char> cells;
+  vector<unsigned char> running; // per board, 0 while it shows game over
+  int bestScore = 0;
+  int finishedGames = 0;
+};
+
+// Many autopilot games stepped in lockstep for the spectator wall. One
+// thread ticks every board and publishes the whole wall through a triple
+// buffer, the renderer only ever uploads the newest one. Headless runs call
+// step() themselves, which keeps them deterministic.
+class BatchSimulation
+{
+  vector<SnakeGame> games;
+  vector<int> gameOverTicks; // left on the game over screen, per board
+  unsigned seed = 1;
+  unsigned gamesStarted = 0;
+  int finishedGames = 0;
+  int gridColumns = 0, gridRows = 0;
+  uint64_t sequence = 0;
+  TripleBuffer<WallSnapshot> snapshots;
+
+  thread worker;
+  mutex wakeMutex;
+  condition_variable wake;
+  bool stopping = false; // guarded by wakeMutex
+  chrono::steady_clock::duration tickInterval;
+
+  void run()
+  {
+    profiler.nameThread("wall");
+    auto nextTick = chrono::steady_clock::now() + tickInterval;
+    unique_lock<mutex> lock(wakeMutex);
+    while (!wake.wait_until(lock, nextTick, [this] { return stopping; }))
+    {
+      lock.unlock();
+      step();
+      auto now = chrono::steady_clock::now();
+      nextTick += tickInterval;
+      if (nextTick <= now)
+        nextTick = now + tickInterval;
+      lock.lock();
+    }
+  }
+
+  // Redraws board index into its tile, the head last so it stays on top
+  void drawBoard(WallSnapshot &snapshot, size_t index) const
+  {
+    const SnakeGame &game = games[index];
+    size_t stride = (size_t)gridColumns * game.columns;
+    size_t left = index % gridColumns * game.columns;
+    size_t bottom = (gridRows - 1 - index / gridColumns) * game.rows;
+    unsigned char *tile = &snapshot.cells[bottom * stride + left];
+    for (int y = 0; y < game.rows; ++y)
+      fill(tile + y * stride, tile + y * stride + game.columns, (unsigned char)CELL_EMPTY);
+    tile[game.fruit.y * stride + game.fruit.x] = CELL_FRUIT;
+    for (size_t i = game.snakeBody.size(); i-- > 0;)
+      tile[game.snakeBody[i].y * stride + game.snakeBody[i].x] = i == 0 ? CELL_HEAD : CELL_BODY;
+  }
+
+  public:
+    // Finished games show game over for this many ticks, then restart
+    static const int gameOverPause = 10;
+
+    // Lays the boards out in a grid about as wide as it is tall
+    void init(int boards, int columns, int rows, unsigned baseSeed)
+    {
+      seed = baseSeed;
+      gamesStarted = 0;
+      finishedGames = 0;
+      gridColumns = (int)ceil(sqrt((double)boards * rows / columns));
+      gridRows = (boards + gridColumns - 1) / gridColumns;
+      games.assign(boards, SnakeGame());
+      gameOverTicks.assign(boards, 0);
+      for (SnakeGame &game : games)
+      {
+        game.columns = columns;
+        game.rows = rows;
+        resetGame(game, seed + gamesStarted++);
+      }
+    }
+
+    size_t size() const
+    {
+      return games.size();
+    }
+
+    int wallColumns() const
+    {
+      return gridColumns;
+    }
+
+    int wallRows() const
+    {
+      return gridRows;
+    }
+
+    void start(chrono::steady_clock::duration interval)
+    {
+      tickInterval = interval;
+      stopping = false;
+      worker = thread(&BatchSimulation::run, this);
+    }
+
+    void stop()
+    {
+      if (!worker.joinable())
+        return;
+      {
+        lock_guard<mutex> lock(wakeMutex);
+        stopping = true;
+      }
+      wake.notify_one();
+      worker.join();
+    }
+
+    ~BatchSimulation()
+    {
+      stop();
+    }
+
+    // Advances every board by one tick and publishes the wall
+    void step()
+    {
+      for (size_t i = 0; i < games.size(); ++i)
+      {
+        SnakeGame &game = games[i];
+        if (game.isGameOver)
+        {
+          if (--gameOverTicks[i] <= 0)
+            resetGame(game, seed + gamesStarted++);
+        }
+        else
+        {
+          game.snakeDirection = steerTowardsFruit(game);
+          moveSnake(game);
+          checkCollisions(game);
+          if (game.isGameOver)
+          {
+            gameOverTicks[i] = gameOverPause;
+            finishedGames++;
+          }
+        }
+        // Nobody replays the deltas, the wall is redrawn in full
+        clearDelta(game);
+      }
+      publish();
+    }
+
+    void publish()
+    {
+      WallSnapshot &snapshot = snapshots.writeSlot();
+      snapshot.sequence = ++sequence;
+      snapshot.boards = games.size();
+      snapshot.gridColumns = gridColumns;
+      snapshot.gridRows = gridRows;
+      snapshot.columns = games.empty() ? 0 : games[0].columns;
+      snapshot.rows = games.empty() ? 0 : games[0].rows;
+      snapshot.cells.resize((size_t)gridColumns * snapshot.columns * gridRows * snapshot.rows);
+      snapshot.running.resize(games.size());
+      snapshot.bestScore = 0;
+      snapshot.finishedGames = finishedGames;
+      for (size_t i = 0; i < games.size(); ++i)
+      {
+        drawBoard(snapshot, i);
+        snapshot.running[i] = !games[i].isGameOver;
+        snapshot.bestScore = max(snapshot.bestScore, games[i].playerScore);
+      }
+      snapshots.publish();
+    }
+
+    // Render thread: true when a newer wall than latest() waits
+    bool hasFreshSnapshot() const
+    {
+      return snapshots.hasFresh();
+    }
+
+    // Render thread: takes the newest wall, false if there was none
+    bool readLatest()
+    {
+      return snapshots.update();
+    }
+
+    const WallSnapshot &latest() const
+    {
+      return snapshots.read();
+    }
+};
@@ -0,0 +1,216 @@
+// Contention benchmark for ConcurrentHashtable: 1 to 64 threads hammer a
+// map of session ids prefilled with half of a fixed key range. Read-heavy
+// is 95% lookups and 5% upserts, write-heavy is 50% lookups, 25% upserts
+// and 25% erases, so shards keep filling with tombstones and regrowing.
+// The same mixes also run against a Hashtable behind one mutex. Prints
+// millions of operations per second over all threads. The churn mix is a
+// session registry over time: every thread keeps 1,000 sessions live,
+// opening a new id, looking up a recent one and closing the oldest, and the
+// growth of the process's resident memory shows whether erased entries are
+// ever given back.
+//
+//   concurrent_hashmap_bench [--threads N] [--ops N]
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+
+#include "utils/concurrent_hashmap.cpp"
+
+using namespace std;
+using namespace chrono;
+
+const uint64_t keyRange = 1 << 20;
+
+struct Session
+{
+  uint32_t player;
+  uint32_t score;
+};
+
+struct Mix
+{
+  const char *name;
+  unsigned readPercent, upsertPercent; // the rest erases
+};
+
+atomic<uint64_t> checksum(0);
+
+// The baseline: one lock around the whole single-threaded table
+class LockedHashtable
+{
+  mutex lock;
+  Hashtable<uint64_t, Session> table;
+
+  public:
+    bool find(uint64_t key, Session &out)
+    {
+      lock_guard<mutex> guard(lock);
+      const Session *session = table.find(key);
+      if (session)
+        out = *session;
+      return session != nullptr;
+    }
+
+    void upsert(uint64_t key, const Session &session)
+    {
+      lock_guard<mutex> guard(lock);
+      table.put(key, session);
+    }
+
+    void erase(uint64_t key)
+    {
+      lock_guard<mutex> guard(lock);
+      table.erase(key);
+    }
+};
+
+template <typename Map>
+void work(Map &map, const Mix &mix, size_t ops, unsigned seed)
+{
+  mt19937_64 rng(seed);
+  uint64_t found = 0;
+  Session session = {0, 0};
+  for (size_t i = 0; i < ops; ++i)
+  {
+    uint64_t r = rng();
+    uint64_t key = r % keyRange;
+    unsigned roll = (r >> 32) % 100;
+    if (roll < mix.readPercent)
+      found += map.find(key, session);
+    else if (roll < mix.readPercent + mix.upsertPercent)
+      map.upsert(key, Session{(uint32_t)key, (uint32_t)i});
+    else
+      map.erase(key);
+  }
+  checksum += found + session.score;
+}
+
+// Millions of operations per second with threadCount threads each doing ops
+template <typename Map>
+double measure(const Mix &mix, unsigned threadCount, size_t ops)
+{
+  Map map;
+  for (uint64_t key = 0; key < keyRange; key += 2)
+    map.upsert(key, Session{(uint32_t)key, 0});
+
+  vector<thread> threads;
+  auto start = steady_clock::now();
+  for (unsigned t = 0; t < threadCount; ++t)
+    threads.emplace_back([&map, &mix, ops, t]() { work(map, mix, ops, t + 1); });
+  for (thread &t : threads)
+    t.join();
+  double seconds = duration<double>(steady_clock::now() - start).count();
+  return threadCount * ops / seconds / 1e6;
+}
+
+const uint64_t liveSessions = 1000;
+
+// Resident memory of the process in MB
+double residentMb()
+{
+  FILE *statm = fopen("/proc/self/statm", "r");
+  long pages = 0, resident = 0;
+  if (statm)
+  {
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+      resident = 0;
+    fclose(statm);
+  }
+  return resident * (double)sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+template <typename Map>
+void churn(Map &map, uint64_t firstKey, size_t ops)
+{
+  uint64_t found = 0;
+  Session session = {0, 0};
+  for (uint64_t key = firstKey + liveSessions; key < firstKey + liveSessions + ops; ++key)
+  {
+    map.upsert(key, Session{(uint32_t)key, 0});
+    found += map.find(key - liveSessions / 2, session);
+    map.erase(key - liveSessions);
+  }
+  checksum += found + session.score;
+}
+
+// Millions of operations per second, and the resident memory gained while
+// running, with threadCount threads each opening ops new sessions
+template <typename Map>
+double measureChurn(unsigned threadCount, size_t ops, double &growthMb)
+{
+  Map map;
+  for (unsigned t = 0; t < threadCount; ++t)
+  {
+    for (uint64_t key = 0; key < liveSessions; ++key)
+      map.upsert((uint64_t)(t + 1) << 40 | key, Session{(uint32_t)key, 0});
+  }
+
+  double before = residentMb();
+  vector<thread> threads;
+  auto start = steady_clock::now();
+  for (unsigned t = 0; t < threadCount; ++t)
+    threads.emplace_back([&map, ops, t]() { churn(map, (uint64_t)(t + 1) << 40, ops); });
+  for (thread &t : threads)
+    t.join();
+  double seconds = duration<double>(steady_clock::now() - start).count();
+  growthMb = residentMb() - before;
+  return threadCount * ops * 3 / seconds / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned maxThreads = 64;
+  size_t totalOps = 4000000;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc)
+      maxThreads = max(atoi(argv[++i]), 1);
+    else if (arg == "--ops" && i + 1 < argc)
+      totalOps = max(atoll(argv[++i]), 1000LL);
+  }
+
+  const Mix mixes[] = {{"read-heavy", 95, 5}, {"write-heavy", 50, 25}};
+  printf("%u hardware threads, %zu operations per run\n", thread::hardware_concurrency(), totalOps);
+  printf("%8s  %23s  %23s\n", "", "read-heavy Mops/s", "write-heavy Mops/s");
+  printf("%8s  %11s %11s  %11s %11s\n", "threads", "one mutex", "sharded", "one mutex", "sharded");
+  for (unsigned threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+  {
+    // The work is split between the threads, so every row does as much
+    size_t ops = totalOps / threadCount;
+    printf("%8u", threadCount);
+    for (const Mix &mix : mixes)
+      printf("  %11.2f %11.2f", measure<LockedHashtable>(mix, threadCount, ops),
+             measure<ConcurrentHashtable<uint64_t, Session>>(mix, threadCount, ops));
+    printf("\n");
+    fflush(stdout);
+  }
+
+  printf("\n%8s  %35s  %35s\n", "", "churn, one mutex", "churn, sharded");
+  printf("%8s  %11s %11s %11s  %11s %11s %11s\n", "threads", "new ids", "Mops/s", "RSS +MB", "new ids", "Mops/s", "RSS +MB");
+  for (unsigned threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+  {
+    size_t ops = totalOps / threadCount;
+    double lockedGrowth, shardedGrowth;
+    double locked = measureChurn<LockedHashtable>(threadCount, ops, lockedGrowth);
+    double sharded = measureChurn<ConcurrentHashtable<uint64_t, Session>>(threadCount, ops, shardedGrowth);
+    printf("%8u  %11zu %11.2f %11.1f  %11zu %11.2f %11.1f\n", threadCount, ops * threadCount, locked, lockedGrowth, ops * threadCount, sharded,
+           shardedGrowth);
+    fflush(stdout);
+  }
+  // Keeps the lookups from being optimized away
+  if (checksum == 42)
+    printf("\n");
+  return 0;
+}
@@ -1,23 +1,97 @@
-#include "utils/hashmap.cpp"
+#include <cstddef>
 
 #define KEY_LEFT 0x0064
 #define KEY_RIGHT 0x0066
 #define KEY_UP 0x0065
 #define KEY_DOWN 0x0067
 
+// STOP is what space does: pause, or restart after game over. NONE marks
+// keys that are not bound to anything.
+enum Direction : unsigned char {
+  NONE,
+  LEFT,
+  RIGHT,
+  UP,
+  DOWN,
+  STOP
+};
+
+// Everything the game asks about a direction, indexed by Direction
+const bool direction_moves[] = {false, true, true, true, true, false};
+const Direction direction_opposite[] = {NONE, RIGHT, LEFT, DOWN, UP, NONE};
+const float direction_dx[] = {0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f};
+const float direction_dy[] = {0.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f};
+
+struct KeyBinding {
+  int key;
+  Direction direction;
+};
+
+// The default bindings, expanded into KeyMaps below
+constexpr KeyBinding defaultKeyBindings[] = {
+  {' ', STOP},
+  {'a', LEFT},
+  {'d', RIGHT},
+  {'w', UP},
+  {'s', DOWN}
+};
+constexpr KeyBinding defaultSpecialKeyBindings[] = {
+  {KEY_LEFT, LEFT},
+  {KEY_RIGHT, RIGHT},
+  {KEY_UP, UP},
+  {KEY_DOWN, DOWN}
+};
+
+// One Direction per key code, so a key press is a single array lookup.
+// Unbound keys map to NONE instead of being added on lookup.
+struct KeyMap {
+  Direction keys[256];
+
+  constexpr Direction operator[](unsigned char key) const noexcept {
+    return keys[key];
+  }
+
+  void bind(unsigned char key, Direction direction) noexcept {
+    keys[key] = direction;
+  }
+};
+
+// C++11 constexpr functions are single expressions, hence the recursion
+template <size_t Count>
+constexpr Direction boundTo(const KeyBinding (&bindings)[Count], int key, size_t i = 0) {
+  return i == Count ? NONE : bindings[i].key == key ? bindings[i].direction : boundTo(bindings, key, i + 1);
+}
+
+template <size_t Count>
+constexpr bool boundTwice(const KeyBinding (&bindings)[Count], size_t i = 0, size_t j = 1) {
+  return i + 1 >= Count ? false
+         : j == Count   ? boundTwice(bindings, i + 1, i + 2)
+                        : bindings[i].key == bindings[j].key || boundTwice(bindings, i, j + 1);
+}
+
+// Expands to the key codes 0-255 so the default tables are built by the
+// compiler
+template <size_t... Keys> struct KeyCodes {};
+template <size_t N, size_t... Keys> struct MakeKeyCodes : MakeKeyCodes<N - 1, N - 1, Keys...> {};
+template <size_t... Keys> struct MakeKeyCodes<0, Keys...> {
+  typedef KeyCodes<Keys...> type;
+};
+
+template <size_t Count, size_t... Keys>
+constexpr KeyMap makeKeyMap(const KeyBinding (&bindings)[Count], KeyCodes<Keys...>) {
+  return KeyMap{{boundTo(bindings, Keys)...}};
+}
+
+constexpr KeyMap defaultKeyMap = makeKeyMap(defaultKeyBindings, MakeKeyCodes<256>::type());
+constexpr KeyMap defaultSpecialKeyMap = makeKeyMap(defaultSpecialKeyBindings, MakeKeyCodes<256>::type());
+
+static_assert(!boundTwice(defaultKeyBindings) && !boundTwice(defaultSpecialKeyBindings), "a key is bound twice");
+static_assert(defaultKeyMap.keys['a'] == LEFT && defaultKeyMap.keys['q'] == NONE, "default key bindings");
+static_assert(defaultSpecialKeyMap.keys[KEY_DOWN] == DOWN, "default special key bindings");
+
+// Starts from the defaults, bind() changes them at runtime
 class Config {
   public:
-    Hashtable<char, string> key_mappings = {
-      {' ', "space"},
-      {'a', "left"},
-      {'d', "right"},
-      {'w', "up"},
-      {'s', "down"}
-    };
-    Hashtable<int, string> skey_mappings = {
-      {KEY_LEFT, "left"},
-      {KEY_RIGHT, "right"},
-      {KEY_UP, "up"},
-      {KEY_DOWN, "down"}
-    };
+    KeyMap key_mappings = defaultKeyMap;
+    KeyMap skey_mappings = defaultSpecialKeyMap;
 };
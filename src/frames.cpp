@@ -0,0 +1,130 @@
+// Generates game frames on the CPU, without any GL, for datasets and
+// thumbnails. Every frame advances the simulation by one tick with the
+// autopilot steering, renders it with SoftRenderer and optionally dumps it.
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "simulation.cpp"
+#include "render/soft_raster.cpp"
+#include "utils/image.cpp"
+#include "render/frame_capture.cpp"
+
+using namespace std;
+using namespace chrono;
+
+int main(int argc, char **argv)
+{
+  int frames = 10000;
+  int width = 1200;
+  int height = 1200;
+  int columns = 40;
+  int rows = 40;
+  int threads = 1;
+  int dumpEvery = 0;
+  unsigned seed = 1;
+  bool full = false;
+  string outDir = ".";
+  string capturePath;
+  int captureFps = 10;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--frames" && i + 1 < argc)
+      frames = atoi(argv[++i]);
+    else if (arg == "--size" && i + 2 < argc)
+    {
+      width = atoi(argv[++i]);
+      height = atoi(argv[++i]);
+    }
+    else if (arg == "--board" && i + 2 < argc)
+    {
+      columns = atoi(argv[++i]);
+      rows = atoi(argv[++i]);
+    }
+    else if (arg == "--threads" && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else if (arg == "--seed" && i + 1 < argc)
+      seed = atoi(argv[++i]);
+    else if (arg == "--dump-every" && i + 1 < argc)
+      dumpEvery = atoi(argv[++i]);
+    else if (arg == "--out" && i + 1 < argc)
+      outDir = argv[++i];
+    else if (arg == "--capture" && i + 1 < argc)
+      capturePath = argv[++i];
+    else if (arg == "--capture-fps" && i + 1 < argc)
+      captureFps = atoi(argv[++i]);
+    else if (arg == "--full")
+      full = true;
+    else
+    {
+      cerr << "usage: frames [--frames N] [--size W H] [--board COLUMNS ROWS] [--threads N] [--seed S]" << endl
+           << "              [--dump-every K] [--out DIR] [--capture FILE.y4m|DIR] [--capture-fps N] [--full]" << endl;
+      return 1;
+    }
+  }
+
+  SnakeGame game;
+  game.columns = columns;
+  game.rows = rows;
+  resetGame(game, seed);
+
+  SoftRenderer renderer(width, height, threads);
+  renderer.alwaysFull = full;
+
+  FrameCapture capture;
+  if (!capturePath.empty() && !capture.start(capturePath, width, height, captureFps, false))
+  {
+    cerr << "Could not open " << capturePath << endl;
+    return 1;
+  }
+
+  long long dirtyTiles = 0;
+  int games = 1;
+  double renderSeconds = 0.0;
+  for (int frame = 0; frame < frames; ++frame)
+  {
+    // A finished game shows its game over frame once, then restarts
+    if (game.isGameOver)
+    {
+      resetGame(game, seed + games++);
+    }
+    else
+    {
+      game.snakeDirection = steerTowardsFruit(game);
+      moveSnake(game);
+      checkCollisions(game);
+    }
+    clearDelta(game);
+
+    auto start = steady_clock::now();
+    renderer.render(game);
+    renderSeconds += duration<double>(steady_clock::now() - start).count();
+    dirtyTiles += renderer.lastDirtyTiles;
+
+    // Offline, so wait for the writer rather than drop frames
+    if (capture.isActive())
+      capture.captureFrame(renderer.pixels(), true);
+
+    if (dumpEvery > 0 && frame % dumpEvery == 0)
+    {
+      string path = outDir + "/frame_" + to_string(frame) + ".ppm";
+      if (!writePPM(path, renderer.pixels(), width, height, false))
+        cerr << "Could not write " << path << endl;
+    }
+  }
+
+  cout << "frames: " << frames << " render time: " << renderSeconds * 1000.0 << " ms fps: " << frames / renderSeconds
+       << " (" << width << "x" << height << ", " << threads << " thread" << (threads == 1 ? "" : "s") << (full ? ", full redraw" : "") << ")" << endl;
+  cout << "dirty tiles: " << (double)dirtyTiles / max(frames, 1) << "/frame, games: " << games << endl;
+  if (capture.isActive())
+  {
+    capture.stop();
+    cout << "capture: " << capture.capturedFrames << " captured, " << capture.writtenFrames << " written, " << capture.droppedFrames << " dropped, " << capture.failedFrames << " failed" << endl;
+    if (capture.closeFailed)
+      cerr << "Could not finish writing " << capturePath << endl;
+  }
+  return capture.failedFrames > 0 || capture.closeFailed ? 1 : 0;
+}
@@ -7,6 +7,10 @@
 #include <random>
 #include <GL/glew.h>
 #include <GL/freeglut.h>
+#include "platform/headless.cpp"
+#include "render/bitmap_font.cpp"
+#include "utils/spsc_queue.cpp"
+#include "utils/latency_histogram.cpp"
 
 using namespace std;
 using namespace chrono;
@@ -39,6 +43,57 @@ enum Direction
 };
 Direction snakeDirection = NONE;
 
+// Turns are queued with the time they were pressed and taken one per tick,
+// checked against the direction the snake last moved in. Two presses within
+// a tick both count, and neither can fold the snake back into itself.
+struct QueuedTurn
+{
+  Direction direction;
+  steady_clock::time_point time;
+};
+SpscQueue<QueuedTurn> queuedTurns(8);
+LatencyHistogram turnLatency; // key press to the tick that turned
+int ignoredTurns = 0;
+
+void queueTurn(Direction direction)
+{
+  if (!queuedTurns.push({direction, steady_clock::now()}))
+    ignoredTurns++;
+}
+
+bool isReversal(Direction direction)
+{
+  return (direction == LEFT && snakeDirection == RIGHT) || (direction == RIGHT && snakeDirection == LEFT) ||
+         (direction == UP && snakeDirection == DOWN) || (direction == DOWN && snakeDirection == UP);
+}
+
+// Takes the first queued turn that changes the direction, the ones before
+// it that would not or would reverse are dropped
+void applyQueuedTurn(steady_clock::time_point tickTime)
+{
+  QueuedTurn turn;
+  while (queuedTurns.pop(turn))
+  {
+    if (turn.direction == snakeDirection || isReversal(turn.direction))
+    {
+      ignoredTurns++;
+      continue;
+    }
+    snakeDirection = turn.direction;
+    turnLatency.record(tickTime - turn.time);
+    return;
+  }
+}
+
+// Key press to turn latency at exit (--stats)
+bool printStats = false;
+
+void printTurnLatency()
+{
+  turnLatency.print(cout, "turn latency");
+  cout << "turns ignored (no change, reversal or queue full): " << ignoredTurns << endl;
+}
+
 // Game State
 bool isGameOver = false;
 int playerScore = 0;
@@ -55,6 +110,7 @@ float getRandomCord()
 
 void placeFruit()
 {
+  PROFILE_SCOPE("placeFruit");
   fruitX = getRandomCord();
   fruitY = getRandomCord();
 }
@@ -62,6 +118,7 @@ void placeFruit()
 // Movement Logic
 void moveSnake()
 {
+  PROFILE_SCOPE("moveSnake");
   if (snakeDirection == NONE || isGameOver)
     return;
 
@@ -114,6 +171,7 @@ void moveSnake()
 // Collision Logic
 void checkCollisions()
 {
+  PROFILE_SCOPE("checkCollisions");
   // Check collision with itself
   for (size_t i = 1; i < snakeBody.size(); ++i)
   {
@@ -158,73 +216,88 @@ void drawFruit()
   drawSquare(fruitX, fruitY, snakeWidth, snakeHeight, 1.0f, 1.0f, 0.0f);
 }
 
-void renderSpacedBitmapString(float x, float y, void *font, const string &text)
-{
-  float x1 = x;
-  for (char c : text)
-  {
-    glRasterPos2f(x1, y);
-    glutBitmapCharacter(font, c);
-    float widthOfChar = (float)(widthPxVal * glutBitmapWidth(font, c));
-    x1 = x1 + widthOfChar;
-  }
-}
+// Glyph advances and laid out strings are cached by the atlas, see
+// render/bitmap_font.cpp
+BitmapFontAtlas textFont;
 
-float getWidthOfSpacedBitmapString(float x, float y, void *font, const string &text)
+void drawText(float x, float y, bool centerText, const string &text)
 {
-  float x1 = x;
-  float widthOfText = 0.0f;
-  for (char c : text)
-  {
-    float widthOfChar = (float)(widthPxVal * glutBitmapWidth(font, c)) / 2;
-    widthOfText = widthOfText + widthOfChar;
-    x1 = x1 + widthOfChar;
-  }
-  return widthOfText;
+  // GLUT bitmap fonts refuse to work without glutInit, which needs a display
+  if (headless)
+    return;
+  const float x1 = centerText ? x - textFont.width(text) * widthPxVal / 2 : x;
+  textFont.draw(x1, y, text, widthPxVal, heightPxVal);
 }
 
-void drawText(float x, float y, bool centerText, void *font, const string &text)
-{
-  const float x1 = centerText ? (getWidthOfSpacedBitmapString(x, y, font, text)) * -1.0f : x;
-  renderSpacedBitmapString(x1, y, font, text);
-}
+// Chrome trace of the frame timers (--profile FILE), written at exit and
+// when P is pressed
+string profilePath;
+
+// Redraws are requested only when the board changed
+bool frameDirty = false;
 
 void render()
 {
+  PROFILE_SCOPE("render");
   glClear(GL_COLOR_BUFFER_BIT);
 
   if (isGameOver)
   {
     glColor3f(0.5f, 1.0f, 0.0f);
-    drawText(0.0f, 0.2f, true, GLUT_BITMAP_HELVETICA_18, "Game Over!");
-    drawText(0.0f, 0.1f, true, GLUT_BITMAP_HELVETICA_18, "Score: " + to_string(playerScore));
-    drawText(0.0f, 0.0f, true, GLUT_BITMAP_HELVETICA_18, "Press 'Space' to restart");
+    drawText(0.0f, 0.2f, true, "Game Over!");
+    drawText(0.0f, 0.1f, true, "Score: " + to_string(playerScore));
+    drawText(0.0f, 0.0f, true, "Press 'Space' to restart");
   }
   else
   {
     drawFruit();
     drawSnake();
-    drawText(-0.9f, 0.9f, false, GLUT_BITMAP_HELVETICA_18, "Score: " + to_string(playerScore));
+    drawText(-0.9f, 0.9f, false, "Score: " + to_string(playerScore));
   }
 
-  glutSwapBuffers();
+  swapBuffers();
+  frameDirty = false;
 }
 
 std::chrono::steady_clock::time_point lastMoveTime = std::chrono::steady_clock::now();
 const std::chrono::milliseconds moveInterval((int)(100 / (0.1f * snakeSpeed)));
 
+// The timer only runs while the snake moves, so a paused or finished game
+// sits idle in GLUT
+bool timerArmed = false;
+
+void timer(int);
+
+void armTimer()
+{
+  if (timerArmed || headless || (snakeDirection == NONE && queuedTurns.size() == 0) || isGameOver)
+    return;
+  timerArmed = true;
+  glutTimerFunc(1000 / frame_rate, timer, 0);
+}
+
+void markDirty()
+{
+  if (!frameDirty && !headless)
+    glutPostRedisplay();
+  frameDirty = true;
+}
+
 void timer(int)
 {
+  timerArmed = false;
   auto currentTime = std::chrono::steady_clock::now();
   bool movementIntervalMet = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastMoveTime) >= moveInterval;
   if (!isGameOver && movementIntervalMet)
+    applyQueuedTurn(currentTime);
+  if (!isGameOver && snakeDirection != NONE && movementIntervalMet)
   {
     moveSnake();
     checkCollisions();
     lastMoveTime = currentTime;
+    markDirty();
   }
-  glutPostRedisplay();
-  glutTimerFunc(1000 / frame_rate, timer, 0);
+  armTimer();
 }
 
 void handleKeypress(unsigned char key, int, int)
@@ -232,20 +305,20 @@ void handleKeypress(unsigned char key, int, int)
   switch (key)
   {
   case 'a':
-    if (snakeDirection != RIGHT)
-      snakeDirection = LEFT;
+    queueTurn(LEFT);
     break;
   case 'd':
-    if (snakeDirection != LEFT)
-      snakeDirection = RIGHT;
+    queueTurn(RIGHT);
     break;
   case 'w':
-    if (snakeDirection != DOWN)
-      snakeDirection = UP;
+    queueTurn(UP);
     break;
   case 's':
-    if (snakeDirection != UP)
-      snakeDirection = DOWN;
+    queueTurn(DOWN);
+    break;
+  case 'p':
+    if (!profilePath.empty())
+      profiler.writeTo(profilePath);
     break;
   case ' ':
     if (isGameOver)
@@ -255,43 +328,100 @@ void handleKeypress(unsigned char key, int, int)
       playerScore = 0;
       isGameOver = false;
       placeFruit();
+      QueuedTurn stale;
+      while (queuedTurns.pop(stale))
+        ;
+      markDirty();
       break;
     }
     snakeDirection = NONE;
     break;
   }
+  armTimer();
 }
 void handleSpecialKeypress(int key, int, int)
 {
   switch (key)
   {
   case GLUT_KEY_LEFT:
-    if (snakeDirection != RIGHT)
-      snakeDirection = LEFT;
+    queueTurn(LEFT);
     break;
   case GLUT_KEY_RIGHT:
-    if (snakeDirection != LEFT)
-      snakeDirection = RIGHT;
+    queueTurn(RIGHT);
     break;
   case GLUT_KEY_UP:
-    if (snakeDirection != DOWN)
-      snakeDirection = UP;
+    queueTurn(UP);
     break;
   case GLUT_KEY_DOWN:
-    if (snakeDirection != UP)
-      snakeDirection = DOWN;
+    queueTurn(DOWN);
     break;
   }
+  armTimer();
+}
+
+void reshape(int w, int h)
+{
+  glViewport(0, 0, w, h);
+  markDirty();
+}
+
+// Headless runs advance on a simulated clock and steer towards the fruit
+// through the same key handler a player would use
+void headlessStep(int frame)
+{
+  if (isGameOver)
+  {
+    handleKeypress(' ', 0, 0);
+    return;
+  }
+
+  const int frameMs = 1000 / frame_rate;
+  if ((frame * frameMs) / moveInterval.count() == ((frame + 1) * frameMs) / moveInterval.count())
+    return;
+
+  float dx = fruitX - snakeBody[0].x;
+  float dy = fruitY - snakeBody[0].y;
+  if (abs(dx) >= snakeWidth)
+    handleKeypress(dx < 0 ? 'a' : 'd', 0, 0);
+  else
+    handleKeypress(dy < 0 ? 's' : 'w', 0, 0);
+  applyQueuedTurn(steady_clock::now());
+  moveSnake();
+  checkCollisions();
 }
 
 int main(int argc, char *argv[])
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(width, height);
-  glutCreateWindow("Snake Game");
+  HeadlessOptions headlessOptions = parseHeadlessArgs(argc, argv);
+  for (int i = 1; i < argc; ++i)
+  {
+    if (string(argv[i]) == "--profile" && i + 1 < argc)
+      profilePath = argv[++i];
+    if (string(argv[i]) == "--stats")
+      printStats = true;
+  }
+  if (!profilePath.empty())
+  {
+    profiler.enable();
+    profiler.nameThread("main");
+  }
+
+  if (headless)
+  {
+    if (!createHeadlessContext(width, height, true))
+      return 1;
+  }
+  else
+  {
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+    glutInitWindowSize(width, height);
+    glutCreateWindow("Snake Game");
+  }
 
   glewInit();
+  if (!headless)
+    textFont.bake(GLUT_BITMAP_HELVETICA_18);
 
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
@@ -299,10 +429,24 @@ int main(int argc, char *argv[])
 
   placeFruit();
 
+  if (headless)
+  {
+    runHeadless(headlessOptions, headlessStep, render);
+    if (!profilePath.empty())
+      profiler.writeTo(profilePath);
+    destroyHeadlessContext();
+    return 0;
+  }
+
   glutDisplayFunc(render);
   glutKeyboardFunc(handleKeypress);
   glutSpecialFunc(handleSpecialKeypress);
-  glutTimerFunc(0, timer, 0);
+  glutReshapeFunc(reshape);
+  // freeglut leaves the main loop through exit()
+  if (printStats)
+    atexit(printTurnLatency);
+  if (!profilePath.empty())
+    atexit([] { profiler.writeTo(profilePath); });
   glutMainLoop();
 
   return 0;
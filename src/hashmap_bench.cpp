@@ -0,0 +1,112 @@
+// Compares the FlatHashMap behind Hashtable with std::unordered_map on
+// random 64-bit keys: inserting N keys into an empty map, then looking up
+// every key (hits) and as many absent keys (misses), in random order.
+// Prints nanoseconds per operation for N = 10 up to --max (10M by default).
+//
+//   hashmap_bench [--max N]
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+#include "utils/hashmap.cpp"
+
+using namespace std;
+using namespace chrono;
+
+// Small maps are rebuilt and searched repeatedly until about this many
+// operations have been timed
+const size_t minOperations = 2000000;
+
+struct Timings
+{
+  double insert, hit, miss; // ns per operation
+};
+
+uint64_t checksum = 0;
+
+template <typename Map>
+Timings measure(const vector<uint64_t> &keys, const vector<uint64_t> &hitOrder, const vector<uint64_t> &misses)
+{
+  size_t rounds = max(minOperations / keys.size(), (size_t)1);
+  Timings timings;
+
+  auto start = steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round)
+  {
+    Map map;
+    for (uint64_t key : keys)
+      map[key] = key;
+    checksum += map.size();
+  }
+  timings.insert = duration<double, nano>(steady_clock::now() - start).count() / (rounds * keys.size());
+
+  Map map;
+  for (uint64_t key : keys)
+    map[key] = key;
+
+  start = steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round)
+    for (uint64_t key : hitOrder)
+      checksum += map.find(key) != map.end();
+  timings.hit = duration<double, nano>(steady_clock::now() - start).count() / (rounds * keys.size());
+
+  start = steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round)
+    for (uint64_t key : misses)
+      checksum += map.find(key) != map.end();
+  timings.miss = duration<double, nano>(steady_clock::now() - start).count() / (rounds * keys.size());
+  return timings;
+}
+
+// find() returns a pointer instead of an iterator, end() lets measure()
+// treat both maps alike
+struct FlatMap : FlatHashMap<uint64_t, uint64_t>
+{
+  const uint64_t *end() const
+  {
+    return nullptr;
+  }
+};
+
+int main(int argc, char **argv)
+{
+  size_t maxKeys = 10000000;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--max" && i + 1 < argc)
+      maxKeys = max(atoll(argv[++i]), 10LL);
+  }
+
+  mt19937_64 rng(1);
+  printf("%10s  %26s  %26s\n", "", "unordered_map ns/op", "FlatHashMap ns/op");
+  printf("%10s  %8s %8s %8s  %8s %8s %8s\n", "keys", "insert", "hit", "miss", "insert", "hit", "miss");
+  for (size_t count = 10; count <= maxKeys; count *= 10)
+  {
+    vector<uint64_t> keys(count), misses(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      keys[i] = rng();
+      misses[i] = rng();
+    }
+    vector<uint64_t> hitOrder = keys;
+    shuffle(hitOrder.begin(), hitOrder.end(), rng);
+
+    Timings standard = measure<unordered_map<uint64_t, uint64_t>>(keys, hitOrder, misses);
+    Timings flat = measure<FlatMap>(keys, hitOrder, misses);
+    printf("%10zu  %8.1f %8.1f %8.1f  %8.1f %8.1f %8.1f\n", count, standard.insert, standard.hit, standard.miss, flat.insert, flat.hit,
+           flat.miss);
+  }
+  // Keeps the lookups from being optimized away
+  if (checksum == 42)
+    printf("\n");
+  return 0;
+}
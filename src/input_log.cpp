@@ -0,0 +1,222 @@
+#pragma once
+
+// Input logs (.snl): one game as the seed, the rules and every accepted turn,
+// enough to play it again tick for tick. A turn is stored as one varint of
+// the ticks since the previous turn shifted left by two, with the direction
+// in the low two bits, so most turns take a single byte. The header also
+// holds the outcome the recording saw, which the replay has to reproduce.
+//
+//   magic "SNKI", version byte, then varints: seed, columns, rows, tick ms,
+//   finished, ticks, score, turn count, followed by the turns
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "simulation.cpp"
+
+using namespace std;
+
+const char inputLogMagic[4] = {'S', 'N', 'K', 'I'};
+const uint8_t inputLogVersion = 2; // 1 placed fruit with uniform_int_distribution
+
+// Logs come from players, so replays are bounded: about 2.5 s of ticks at
+// full speed and a board no larger than a megacell
+const uint64_t maxLogTicks = 100000000;
+const int maxLogBoardSize = 1024;
+
+struct InputLog
+{
+  uint32_t seed = 0;
+  int columns = 40;
+  int rows = 40;
+  int tickMs = 100;      // informational, replays run as fast as they can
+  bool finished = false; // ended in game over rather than being cut short
+  uint64_t ticks = 0;    // ticks the snake moved in
+  int score = 0;
+  uint64_t turnCount = 0;
+  vector<uint8_t> turns;
+};
+
+void appendVarint(vector<uint8_t> &bytes, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    bytes.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back((uint8_t)value);
+}
+
+// False when the bytes run out or the value does not fit 64 bits
+bool readVarint(const uint8_t *&at, const uint8_t *end, uint64_t &value)
+{
+  value = 0;
+  for (int shift = 0; shift < 64 && at < end; shift += 7)
+  {
+    uint8_t byte = *at++;
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// Records the game the simulation is running. Only ticks that moved the
+// snake count, so pauses cost nothing and need no entry of their own.
+class InputRecorder
+{
+  InputLog current;
+  uint64_t lastTurnTick = 0;
+
+  public:
+    void begin(const SnakeGame &game, uint32_t seed, int tickMs)
+    {
+      current = InputLog();
+      current.seed = seed;
+      current.columns = game.columns;
+      current.rows = game.rows;
+      current.tickMs = tickMs;
+      lastTurnTick = 0;
+    }
+
+    void tick()
+    {
+      current.ticks++;
+    }
+
+    // A turn the simulation accepted, effective from the next tick
+    void turn(Direction direction)
+    {
+      appendVarint(current.turns, (current.ticks - lastTurnTick) << 2 | (uint64_t)(direction - LEFT));
+      lastTurnTick = current.ticks;
+      current.turnCount++;
+    }
+
+    // True until the snake has moved, a game like that is not worth saving
+    bool empty() const
+    {
+      return current.ticks == 0;
+    }
+
+    // Takes the outcome so far, call again if the game goes on
+    const InputLog &finish(const SnakeGame &game)
+    {
+      current.finished = game.isGameOver;
+      current.score = game.playerScore;
+      return current;
+    }
+};
+
+bool saveInputLog(const string &path, const InputLog &log)
+{
+  vector<uint8_t> bytes(inputLogMagic, inputLogMagic + 4);
+  bytes.push_back(inputLogVersion);
+  appendVarint(bytes, log.seed);
+  appendVarint(bytes, log.columns);
+  appendVarint(bytes, log.rows);
+  appendVarint(bytes, log.tickMs);
+  appendVarint(bytes, log.finished);
+  appendVarint(bytes, log.ticks);
+  appendVarint(bytes, log.score);
+  appendVarint(bytes, log.turnCount);
+  bytes.insert(bytes.end(), log.turns.begin(), log.turns.end());
+
+  ofstream file(path, ios::binary);
+  file.write((const char *)bytes.data(), bytes.size());
+  return (bool)file;
+}
+
+bool loadInputLog(const string &path, InputLog &log)
+{
+  ifstream file(path, ios::binary);
+  if (!file)
+    return false;
+  vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+  if (bytes.size() < 5 || !equal(inputLogMagic, inputLogMagic + 4, bytes.begin()) || bytes[4] != inputLogVersion)
+    return false;
+
+  const uint8_t *at = bytes.data() + 5, *end = bytes.data() + bytes.size();
+  uint64_t fields[8];
+  for (uint64_t &field : fields)
+  {
+    if (!readVarint(at, end, field))
+      return false;
+  }
+  log.seed = (uint32_t)fields[0];
+  log.columns = (int)fields[1];
+  log.rows = (int)fields[2];
+  log.tickMs = (int)fields[3];
+  log.finished = fields[4] != 0;
+  log.ticks = fields[5];
+  log.score = (int)fields[6];
+  log.turnCount = fields[7];
+  log.turns.assign(at, end);
+  return fields[1] >= 1 && fields[1] <= (uint64_t)maxLogBoardSize && fields[2] >= 1 && fields[2] <= (uint64_t)maxLogBoardSize &&
+         log.ticks <= maxLogTicks;
+}
+
+struct ReplayResult
+{
+  uint64_t ticks = 0;
+  int score = 0;
+  bool gameOver = false;
+  bool malformed = false; // turns ran out early, came after the game ended or went past the limits
+};
+
+// Plays the log back through the simulation core, no rendering and no
+// clock. game ends up as the recording left it. A log beyond maxLogTicks
+// or maxLogBoardSize is malformed and not played at all.
+ReplayResult replayInputLog(const InputLog &log, SnakeGame &game)
+{
+  ReplayResult result;
+  if (log.ticks > maxLogTicks || log.columns < 1 || log.columns > maxLogBoardSize || log.rows < 1 || log.rows > maxLogBoardSize)
+  {
+    result.malformed = true;
+    return result;
+  }
+  game.columns = log.columns;
+  game.rows = log.rows;
+  resetGame(game, log.seed);
+
+  auto advance = [&](uint64_t untilTick) {
+    while (result.ticks < untilTick && !game.isGameOver)
+    {
+      moveSnake(game);
+      checkCollisions(game);
+      result.ticks++;
+    }
+  };
+
+  const uint8_t *at = log.turns.data(), *end = at + log.turns.size();
+  for (uint64_t i = 0; i < log.turnCount; ++i)
+  {
+    uint64_t entry;
+    if (!readVarint(at, end, entry) || (entry >> 2) > log.ticks - result.ticks)
+    {
+      result.malformed = true;
+      break;
+    }
+    advance(result.ticks + (entry >> 2));
+    if (game.isGameOver)
+    {
+      result.malformed = true;
+      break;
+    }
+    // Accepted when recorded, so never a reversal
+    game.snakeDirection = (Direction)(LEFT + (entry & 3));
+  }
+  advance(log.ticks);
+
+  result.score = game.playerScore;
+  result.gameOver = game.isGameOver;
+  return result;
+}
+
+// True when the replay reproduced the recorded outcome
+bool replayMatches(const InputLog &log, const ReplayResult &result)
+{
+  return !result.malformed && result.ticks == log.ticks && result.score == log.score && result.gameOver == log.finished;
+}
@@ -14,6 +14,7 @@
 #include <GL/freeglut.h>
 #include "utils/utils.cpp"
 #include "config.cpp"
+#include "render/bitmap_font.cpp"
 
 using namespace std;
 
@@ -40,7 +41,7 @@ float snake_height = heightPxVal * (height / rows);
 int snake_length = 1;
 
 float snake_speed = snake_width / 3;
-string snake_direction = "space";
+Direction snake_direction = STOP;
 
 float getRandomCords() {
   float randFloat = ((double) rand() / (RAND_MAX)) * 2 - 1;
@@ -54,36 +55,22 @@ float fruitCordY = getRandomCords();
 
 float pCords[2];
 float * prevCords(float x, float y) {
-  if (snake_direction == "left") {
-    pCords[0] = x; // + snake_speed;
+  if (direction_moves[snake_direction]) {
+    pCords[0] = x;
     pCords[1] = y;
   }
-  if (snake_direction == "right") {
-    pCords[0] = x; // - snake_speed;
-    pCords[1] = y;
-  }
-  if (snake_direction == "up") {
-    pCords[0] = x; //;
-    pCords[1] = y; // - snake_speed;
-  }
-  if (snake_direction == "down") {
-    pCords[0] = x; //;
-    pCords[1] = y; // + snake_speed;
-  }
   return pCords;
 }
 
 float nCord;
 float nextCord(float cord) {
-  if (snake_direction == "left") nCord = cord - widthPxVal;
-  if (snake_direction == "right") nCord = cord + widthPxVal;
-  if (snake_direction == "up") nCord = cord + heightPxVal;
-  if (snake_direction == "down") nCord = cord - heightPxVal;
+  if (direction_moves[snake_direction])
+    nCord = cord + (direction_dx[snake_direction] * widthPxVal + direction_dy[snake_direction] * heightPxVal);
   return nCord;
 }
 
 void moveSnake() {
-  if (snake_direction == "space" || isGameOver) return;
+  if (!direction_moves[snake_direction] || isGameOver) return;
   float prevX = prevCords(snake_xPos[0], snake_yPos[0])[0];
   float prevY = prevCords(snake_xPos[0], snake_yPos[0])[1];
   float prev2X, prev2Y;
@@ -99,22 +86,14 @@ void moveSnake() {
     prevY = prev2Y;
   }
 
-  if (snake_direction == "left") {
-    if (snake_head_xPos <= 1.0f * -1) snake_head_xPos = 1.0f;
-    snake_head_xPos -= snake_width;
-  }
-  if (snake_direction == "right") {
-    if (snake_head_xPos >= 1.0f) snake_head_xPos = -1.0f;
-    snake_head_xPos += snake_width;
-  }
-  if (snake_direction == "up") {
-    if (snake_head_yPos >= 1.0f) snake_head_yPos = -1.0f;
-    snake_head_yPos += snake_height;
-  }
-  if (snake_direction == "down") {
-    if (snake_head_yPos <= 1.0f * -1) snake_head_yPos = 1.0f;
-    snake_head_yPos -= snake_height;
-  }
+  // Wrap around before stepping off the edge
+  float dx = direction_dx[snake_direction], dy = direction_dy[snake_direction];
+  if (dx < 0.0f && snake_head_xPos <= 1.0f * -1) snake_head_xPos = 1.0f;
+  if (dx > 0.0f && snake_head_xPos >= 1.0f) snake_head_xPos = -1.0f;
+  if (dy > 0.0f && snake_head_yPos >= 1.0f) snake_head_yPos = -1.0f;
+  if (dy < 0.0f && snake_head_yPos <= 1.0f * -1) snake_head_yPos = 1.0f;
+  snake_head_xPos += dx * snake_width;
+  snake_head_yPos += dy * snake_height;
   // Log Stats
   // cout<<"X Position: "<<snake_xPos[0]<<" Width: "<<snake_width<<endl;
   // cout<<"Y Position: "<<snake_yPos[0]<<" Width: "<<snake_height<<endl;
@@ -142,10 +121,13 @@ void ruleCheck() {
   }
 }
 
-void drawSnake() {
+// Advances the game by one step, rendering no longer does this
+void tick() {
   moveSnake();
   ruleCheck();
+}
 
+void drawSnake() {
   glBegin(GL_QUADS);
     glColor3f(1.0f, 1.0f, 0.0f);
     glVertex2f(fruitCordX, fruitCordY); // top left
@@ -179,32 +161,12 @@ void drawSnake() {
   }
 }
 
-void renderSpacedBitmapString(float x, float y, void *font, char *string) {
-  int i, len;
-  float x1 = x;
-  for (i = 0, len = strlen(string); i < len; i++) {
-    glRasterPos2f(x1, y);
-    glutBitmapCharacter(font, (int)string[i]);
-    float widthOfChar = (float)(widthPxVal * glutBitmapWidth(font, (int)string[i]));
-    x1 = x1 + widthOfChar;
-  }
-}
+// Glyph advances and laid out strings are cached by the atlas
+BitmapFontAtlas textFont;
 
-float getWidthOfSpacedBitmapString(float x, float y, void *font, char *string) {
-  int i, len;
-  float x1 = x;
-  float widthOfText = 0.0f;
-  for (i = 0, len = strlen(string); i < len; i++) {
-    float widthOfChar = (float)(widthPxVal * glutBitmapWidth(font, (int)string[i])) / 2;
-    widthOfText = widthOfText + widthOfChar;
-    x1 = x1 + widthOfChar;
-  }
-  return widthOfText;
-}
-
-void drawText(float x, float y, bool centerText, void *font, char *string) {
-  const float x1 = centerText ? (getWidthOfSpacedBitmapString(x, y, font, string)) * -1.0f : x;
-  renderSpacedBitmapString(x1, y, font, string);
+void drawText(float x, float y, bool centerText, const char *string) {
+  const float x1 = centerText ? x - textFont.width(string) * widthPxVal / 2 : x;
+  textFont.draw(x1, y, string, widthPxVal, heightPxVal);
 }
 
 void restartGame() {
@@ -217,14 +179,14 @@ void restartGame() {
   fruitCordX = getRandomCords();
   fruitCordY = getRandomCords();
   isGameOver = false;
-  snake_direction = " ";
+  snake_direction = NONE;
 }
 
 void drawScore(float y) {
   char scoreText[15] = "Score: ";
   const char * scoreAsChars = intToStr(playerScore);
   char * playerScoreText = strcat(scoreText, scoreAsChars);
-  drawText(0.0f, y, true, GLUT_BITMAP_HELVETICA_18, playerScoreText);
+  drawText(0.0f, y, true, playerScoreText);
 }
 
 void gameOver() {
@@ -234,9 +196,9 @@ void gameOver() {
   char * playerScoreText = strcat(scoreText, scoreAsChars);
   char infoText[29] = "press 'space' to start again";
   glColor3f(0.5f, 1.0f, 0.0f);
-  drawText(0.0f, 0.8f, true, GLUT_BITMAP_HELVETICA_18, gameOverText);
-  drawText(0.0f, 0.73f, true, GLUT_BITMAP_HELVETICA_18, playerScoreText);
-  drawText(0.0f, 0.66f, true, GLUT_BITMAP_HELVETICA_18, infoText);
+  drawText(0.0f, 0.8f, true, gameOverText);
+  drawText(0.0f, 0.73f, true, playerScoreText);
+  drawText(0.0f, 0.66f, true, infoText);
 }
 
 void onDisplay()
@@ -249,10 +211,6 @@ void onDisplay()
   if (isGameOver) {
     gameOver();
     glFlush();
-    if (snake_direction == "space") {
-      restartGame();
-      glFlush();
-    }
   } else {
     drawSnake();
     glFlush();
@@ -262,29 +220,54 @@ void onDisplay()
   glutSwapBuffers();
 }
 
+// The timer only runs while the snake is moving and every tick moves it, so
+// a paused or finished game waits in glutMainLoop without redrawing
+bool timerArmed = false;
+
+bool isMoving() {
+  return !isGameOver && direction_moves[snake_direction];
+}
+
 void timer(int) {
-  onDisplay();
+  timerArmed = false;
+  if (!isMoving()) return;
+  tick();
+  glutPostRedisplay();
+  timerArmed = true;
   glutTimerFunc(1000/frame_rate, timer, 0);
 }
 
-bool isIlligelMove(string direction) {
-  if (snake_direction == "left" && direction == "right") return true;
-  if (snake_direction == "right" && direction == "left") return true;
-  if (snake_direction == "up" && direction == "down") return true;
-  if (snake_direction == "down" && direction == "up") return true;
-  if (direction != "left" && direction != "right" && direction != "up" && direction != "down" && direction != "space") return true;
-  return false;
+void armTimer() {
+  if (timerArmed || !isMoving()) return;
+  timerArmed = true;
+  glutTimerFunc(1000/frame_rate, timer, 0);
+}
+
+bool isIlligelMove(Direction direction) {
+  return direction == NONE || (direction_moves[snake_direction] && direction == direction_opposite[snake_direction]);
 }
 
 void handleKeypress(unsigned char key, int x, int y) {
-  if (isIlligelMove(config.key_mappings.get(key))) return;
-  snake_direction = config.key_mappings.get(key);
-  onDisplay();
+  Direction direction = config.key_mappings[key];
+  if (isIlligelMove(direction)) return;
+  snake_direction = direction;
+  if (isGameOver && snake_direction == STOP) {
+    restartGame();
+    glutPostRedisplay();
+  }
+  armTimer();
 }
 void handleSpecialKeypress(int key, int x, int y) {
-  if (isIlligelMove(config.skey_mappings.get(key))) return;
-  snake_direction = config.skey_mappings.get(key);
-  onDisplay();
+  if (key < 0 || key > 255) return;
+  Direction direction = config.skey_mappings[key];
+  if (isIlligelMove(direction)) return;
+  snake_direction = direction;
+  armTimer();
+}
+
+void onReshape(int w, int h) {
+  glViewport(0, 0, w, h);
+  glutPostRedisplay();
 }
 
 int main(int argc, char* argv[]) {
@@ -293,17 +276,18 @@ int main(int argc, char* argv[]) {
   glutInitDisplayMode(GLUT_RGBA|GLUT_DOUBLE|GLUT_DEPTH);
   glutInitWindowSize(width, height);
   glutCreateWindow("Snake");
-  timer(0);
 
   GLenum glew_status = glewInit();
   if (glew_status != GLEW_OK) {
     fprintf(stderr, "Error: %s\n", glewGetErrorString(glew_status));
     return 1;
   }
+  textFont.bake(GLUT_BITMAP_HELVETICA_18);
 
   glutDisplayFunc(onDisplay);
   glutKeyboardFunc(handleKeypress);
   glutSpecialFunc(handleSpecialKeypress);
+  glutReshapeFunc(onReshape);
   glutMainLoop();
 
   return 0;
@@ -0,0 +1,123 @@
+// Stress test for the particle system: integrates, uploads and draws a pool
+// of long-lived particles every frame and prints the median cost of each
+// stage. Draws offscreen through EGL, --no-draw measures integration alone.
+//
+//   particle_bench [--particles N] [--frames N] [--no-draw]
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GL/glut.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+
+#include "platform/headless.cpp"
+#include "render/particles.cpp"
+
+using namespace std;
+using namespace chrono;
+
+GLuint compileShader(GLenum type, const char *source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+  return shader;
+}
+
+GLuint createParticleProgram()
+{
+  GLuint program = glCreateProgram();
+  glAttachShader(program, compileShader(GL_VERTEX_SHADER, particleVertexShaderSource));
+  glAttachShader(program, compileShader(GL_FRAGMENT_SHADER, particleFragmentShaderSource));
+  glLinkProgram(program);
+  GLint linked;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  return linked ? program : 0;
+}
+
+double median(vector<double> times)
+{
+  sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+  int count = 1000000;
+  int frames = 60;
+  bool draw = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--particles" && i + 1 < argc)
+      count = max(atoi(argv[++i]), 1);
+    else if (arg == "--frames" && i + 1 < argc)
+      frames = max(atoi(argv[++i]), 1);
+    else if (arg == "--no-draw")
+      draw = false;
+  }
+
+  GLuint program = 0;
+  if (draw)
+  {
+    if (!createHeadlessContext(800, 800, false))
+      return 1;
+    program = createParticleProgram();
+    if (!program)
+    {
+      cerr << "Could not build the particle program" << endl;
+      return 1;
+    }
+    glUseProgram(program);
+    glUniform4f(glGetUniformLocation(program, "uTransform"), 0.05f, 0.05f, 0.0f, 0.0f);
+    glUniform1f(glGetUniformLocation(program, "uPointSize"), 2.0f);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  }
+
+  ParticleSystem particles;
+  particles.init(count);
+  if (draw)
+    particles.bind(program);
+  // Long lives keep the pool full for the whole run
+  ParticleBurst burst = {count, 0.5f, 20.0f, 1000.0f, 2000.0f, particleColor(255, 200, 0)};
+  particles.spawn(0.0f, 0.0f, burst);
+
+  vector<double> updateTimes, uploadTimes, drawTimes;
+  const float dt = 1.0f / 144.0f;
+  for (int frame = 0; frame < frames; ++frame)
+  {
+    auto start = steady_clock::now();
+    particles.update(dt);
+    updateTimes.push_back(duration<double, milli>(steady_clock::now() - start).count());
+    if (!draw)
+      continue;
+
+    start = steady_clock::now();
+    particles.upload();
+    glFinish();
+    uploadTimes.push_back(duration<double, milli>(steady_clock::now() - start).count());
+
+    start = steady_clock::now();
+    glClear(GL_COLOR_BUFFER_BIT);
+    particles.draw();
+    glFinish();
+    drawTimes.push_back(duration<double, milli>(steady_clock::now() - start).count());
+  }
+
+  double update = median(updateTimes);
+  printf("%zu particles, median of %d frames\n", particles.size(), frames);
+  printf("update   %8.3f ms  (%.2f ns/particle)\n", update, update * 1e6 / particles.size());
+  if (draw)
+  {
+    printf("upload   %8.3f ms\n", median(uploadTimes));
+    printf("draw     %8.3f ms  (one GL_POINTS call)\n", median(drawTimes));
+    destroyHeadlessContext();
+  }
+  return 0;
+}
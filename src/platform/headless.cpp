@@ -0,0 +1,186 @@
+#pragma once
+
+// Offscreen rendering through EGL for machines without a display or GPU
+// (Mesa falls back to llvmpipe). Include after the GL and GLUT headers, the
+// including program decides between GLES2 and desktop GL.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "../utils/image.cpp"
+#include "../utils/profiler.cpp"
+
+using namespace std;
+
+struct HeadlessContext
+{
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLSurface surface = EGL_NO_SURFACE;
+  EGLContext context = EGL_NO_CONTEXT;
+  int width = 0;
+  int height = 0;
+};
+
+bool headless = false;
+HeadlessContext headlessContext;
+
+// Last frame read back from the pbuffer, RGBA rows bottom to top
+vector<unsigned char> headlessPixels;
+bool headlessReadback = true;
+
+EGLDisplay getHeadlessDisplay()
+{
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+    return display;
+
+  // No X or Wayland server, ask Mesa for a surfaceless display instead
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (!getPlatformDisplay)
+    return EGL_NO_DISPLAY;
+  display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+    return EGL_NO_DISPLAY;
+  return display;
+}
+
+// Creates a pbuffer-backed context in place of glutCreateWindow. desktopGL
+// selects a compatibility GL context for the immediate mode renderer,
+// otherwise a GLES2 context is created.
+bool createHeadlessContext(int width, int height, bool desktopGL)
+{
+  HeadlessContext &ctx = headlessContext;
+  ctx.display = getHeadlessDisplay();
+  if (ctx.display == EGL_NO_DISPLAY)
+  {
+    cerr << "Headless: no EGL display available" << endl;
+    return false;
+  }
+
+  EGLint configAttribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, desktopGL ? EGL_OPENGL_BIT : EGL_OPENGL_ES2_BIT,
+      EGL_RED_SIZE, 8,
+      EGL_GREEN_SIZE, 8,
+      EGL_BLUE_SIZE, 8,
+      EGL_ALPHA_SIZE, 8,
+      EGL_NONE};
+  EGLConfig config;
+  EGLint numConfigs = 0;
+  if (!eglChooseConfig(ctx.display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0)
+  {
+    cerr << "Headless: no matching EGL config" << endl;
+    return false;
+  }
+
+  EGLint surfaceAttribs[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+  ctx.surface = eglCreatePbufferSurface(ctx.display, config, surfaceAttribs);
+  if (ctx.surface == EGL_NO_SURFACE)
+  {
+    cerr << "Headless: failed to create pbuffer (0x" << hex << eglGetError() << dec << ")" << endl;
+    return false;
+  }
+
+  eglBindAPI(desktopGL ? EGL_OPENGL_API : EGL_OPENGL_ES_API);
+  EGLint esContextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+  EGLint glContextAttribs[] = {EGL_NONE};
+  ctx.context = eglCreateContext(ctx.display, config, EGL_NO_CONTEXT, desktopGL ? glContextAttribs : esContextAttribs);
+  if (ctx.context == EGL_NO_CONTEXT || !eglMakeCurrent(ctx.display, ctx.surface, ctx.surface, ctx.context))
+  {
+    cerr << "Headless: failed to create context (0x" << hex << eglGetError() << dec << ")" << endl;
+    return false;
+  }
+
+  ctx.width = width;
+  ctx.height = height;
+  headlessPixels.resize((size_t)width * height * 4);
+  headless = true;
+  return true;
+}
+
+void destroyHeadlessContext()
+{
+  HeadlessContext &ctx = headlessContext;
+  if (ctx.display == EGL_NO_DISPLAY)
+    return;
+  eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(ctx.display, ctx.context);
+  eglDestroySurface(ctx.display, ctx.surface);
+  eglTerminate(ctx.display);
+  ctx = HeadlessContext();
+  headless = false;
+}
+
+// Stands in for glutSwapBuffers so render functions work in both modes
+void swapBuffers()
+{
+  PROFILE_SCOPE("swapBuffers");
+  if (!headless)
+  {
+    glutSwapBuffers();
+    return;
+  }
+
+  if (headlessReadback)
+    glReadPixels(0, 0, headlessContext.width, headlessContext.height, GL_RGBA, GL_UNSIGNED_BYTE, headlessPixels.data());
+  else
+    glFinish();
+}
+
+// Writes the last read back frame as a binary PPM
+bool dumpHeadlessFrame(const string &path)
+{
+  return writePPM(path, headlessPixels.data(), headlessContext.width, headlessContext.height, true);
+}
+
+struct HeadlessOptions
+{
+  int frames = 600;
+  string dumpPath;
+};
+
+// Parses --headless, --frames N, --no-readback and --dump FILE
+HeadlessOptions parseHeadlessArgs(int argc, char **argv)
+{
+  HeadlessOptions options;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--headless")
+      headless = true;
+    else if (arg == "--frames" && i + 1 < argc)
+      options.frames = atoi(argv[++i]);
+    else if (arg == "--no-readback")
+      headlessReadback = false;
+    else if (arg == "--dump" && i + 1 < argc)
+      options.dumpPath = argv[++i];
+  }
+  return options;
+}
+
+// Drives step + display for a fixed number of frames as fast as possible and
+// prints the achieved frame rate
+double runHeadless(const HeadlessOptions &options, void (*step)(int frame), void (*display)())
+{
+  auto start = chrono::steady_clock::now();
+  for (int frame = 0; frame < options.frames; ++frame)
+  {
+    step(frame);
+    display();
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  double fps = options.frames / seconds;
+
+  cout << "frames: " << options.frames << " time: " << seconds * 1000.0 << " ms fps: " << fps
+       << " (" << headlessContext.width << "x" << headlessContext.height << (headlessReadback ? ", readback" : "") << ")" << endl;
+
+  if (!options.dumpPath.empty() && headlessReadback && !dumpHeadlessFrame(options.dumpPath))
+    cerr << "Headless: could not write " << options.dumpPath << endl;
+  return fps;
+}
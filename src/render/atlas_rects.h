@@ -0,0 +1,301 @@
+// Generated by atlas_packer for web/res/atlas.png, run `make atlas` instead of editing.
+// Sources: web/res/font_texture.png (16x16) web/res/snake-graphics.png (5x4)
+
+#pragma once
+
+// Texture coordinates of one sprite, v runs from the top row down
+struct AtlasRect
+{
+  float u1, v1, u2, v2;
+};
+
+constexpr int atlasWidth = 512;
+constexpr int atlasHeight = 512;
+
+// web/res/font_texture.png, row major
+constexpr int fontColumns = 16;
+constexpr int fontRows = 16;
+constexpr AtlasRect fontRects[256] = {
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.47265625f, 0.26953125f, 0.53515625f, 0.33203125f},
+    {0.54296875f, 0.26953125f, 0.60546875f, 0.33203125f},
+    {0.61328125f, 0.26953125f, 0.67578125f, 0.33203125f},
+    {0.68359375f, 0.26953125f, 0.74609375f, 0.33203125f},
+    {0.75390625f, 0.26953125f, 0.81640625f, 0.33203125f},
+    {0.82421875f, 0.26953125f, 0.88671875f, 0.33203125f},
+    {0.89453125f, 0.26953125f, 0.95703125f, 0.33203125f},
+    {0.00390625f, 0.40234375f, 0.06640625f, 0.46484375f},
+    {0.07421875f, 0.40234375f, 0.13671875f, 0.46484375f},
+    {0.14453125f, 0.40234375f, 0.20703125f, 0.46484375f},
+    {0.21484375f, 0.40234375f, 0.27734375f, 0.46484375f},
+    {0.28515625f, 0.40234375f, 0.34765625f, 0.46484375f},
+    {0.35546875f, 0.40234375f, 0.41796875f, 0.46484375f},
+    {0.42578125f, 0.40234375f, 0.48828125f, 0.46484375f},
+    {0.49609375f, 0.40234375f, 0.55859375f, 0.46484375f},
+    {0.56640625f, 0.40234375f, 0.62890625f, 0.46484375f},
+    {0.63671875f, 0.40234375f, 0.69921875f, 0.46484375f},
+    {0.70703125f, 0.40234375f, 0.76953125f, 0.46484375f},
+    {0.77734375f, 0.40234375f, 0.83984375f, 0.46484375f},
+    {0.84765625f, 0.40234375f, 0.91015625f, 0.46484375f},
+    {0.91796875f, 0.40234375f, 0.98046875f, 0.46484375f},
+    {0.00390625f, 0.47265625f, 0.06640625f, 0.53515625f},
+    {0.07421875f, 0.47265625f, 0.13671875f, 0.53515625f},
+    {0.14453125f, 0.47265625f, 0.20703125f, 0.53515625f},
+    {0.21484375f, 0.47265625f, 0.27734375f, 0.53515625f},
+    {0.28515625f, 0.47265625f, 0.34765625f, 0.53515625f},
+    {0.35546875f, 0.47265625f, 0.41796875f, 0.53515625f},
+    {0.42578125f, 0.47265625f, 0.48828125f, 0.53515625f},
+    {0.49609375f, 0.47265625f, 0.55859375f, 0.53515625f},
+    {0.56640625f, 0.47265625f, 0.62890625f, 0.53515625f},
+    {0.63671875f, 0.47265625f, 0.69921875f, 0.53515625f},
+    {0.70703125f, 0.47265625f, 0.76953125f, 0.53515625f},
+    {0.77734375f, 0.47265625f, 0.83984375f, 0.53515625f},
+    {0.84765625f, 0.47265625f, 0.91015625f, 0.53515625f},
+    {0.91796875f, 0.47265625f, 0.98046875f, 0.53515625f},
+    {0.00390625f, 0.54296875f, 0.06640625f, 0.60546875f},
+    {0.07421875f, 0.54296875f, 0.13671875f, 0.60546875f},
+    {0.14453125f, 0.54296875f, 0.20703125f, 0.60546875f},
+    {0.21484375f, 0.54296875f, 0.27734375f, 0.60546875f},
+    {0.28515625f, 0.54296875f, 0.34765625f, 0.60546875f},
+    {0.35546875f, 0.54296875f, 0.41796875f, 0.60546875f},
+    {0.42578125f, 0.54296875f, 0.48828125f, 0.60546875f},
+    {0.49609375f, 0.54296875f, 0.55859375f, 0.60546875f},
+    {0.56640625f, 0.54296875f, 0.62890625f, 0.60546875f},
+    {0.63671875f, 0.54296875f, 0.69921875f, 0.60546875f},
+    {0.70703125f, 0.54296875f, 0.76953125f, 0.60546875f},
+    {0.77734375f, 0.54296875f, 0.83984375f, 0.60546875f},
+    {0.84765625f, 0.54296875f, 0.91015625f, 0.60546875f},
+    {0.91796875f, 0.54296875f, 0.98046875f, 0.60546875f},
+    {0.00390625f, 0.61328125f, 0.06640625f, 0.67578125f},
+    {0.07421875f, 0.61328125f, 0.13671875f, 0.67578125f},
+    {0.14453125f, 0.61328125f, 0.20703125f, 0.67578125f},
+    {0.21484375f, 0.61328125f, 0.27734375f, 0.67578125f},
+    {0.28515625f, 0.61328125f, 0.34765625f, 0.67578125f},
+    {0.35546875f, 0.61328125f, 0.41796875f, 0.67578125f},
+    {0.42578125f, 0.61328125f, 0.48828125f, 0.67578125f},
+    {0.49609375f, 0.61328125f, 0.55859375f, 0.67578125f},
+    {0.56640625f, 0.61328125f, 0.62890625f, 0.67578125f},
+    {0.63671875f, 0.61328125f, 0.69921875f, 0.67578125f},
+    {0.70703125f, 0.61328125f, 0.76953125f, 0.67578125f},
+    {0.77734375f, 0.61328125f, 0.83984375f, 0.67578125f},
+    {0.84765625f, 0.61328125f, 0.91015625f, 0.67578125f},
+    {0.91796875f, 0.61328125f, 0.98046875f, 0.67578125f},
+    {0.00390625f, 0.68359375f, 0.06640625f, 0.74609375f},
+    {0.07421875f, 0.68359375f, 0.13671875f, 0.74609375f},
+    {0.14453125f, 0.68359375f, 0.20703125f, 0.74609375f},
+    {0.21484375f, 0.68359375f, 0.27734375f, 0.74609375f},
+    {0.28515625f, 0.68359375f, 0.34765625f, 0.74609375f},
+    {0.35546875f, 0.68359375f, 0.41796875f, 0.74609375f},
+    {0.42578125f, 0.68359375f, 0.48828125f, 0.74609375f},
+    {0.49609375f, 0.68359375f, 0.55859375f, 0.74609375f},
+    {0.56640625f, 0.68359375f, 0.62890625f, 0.74609375f},
+    {0.63671875f, 0.68359375f, 0.69921875f, 0.74609375f},
+    {0.70703125f, 0.68359375f, 0.76953125f, 0.74609375f},
+    {0.77734375f, 0.68359375f, 0.83984375f, 0.74609375f},
+    {0.35546875f, 0.54296875f, 0.41796875f, 0.60546875f},
+    {0.84765625f, 0.68359375f, 0.91015625f, 0.74609375f},
+    {0.91796875f, 0.68359375f, 0.98046875f, 0.74609375f},
+    {0.00390625f, 0.75390625f, 0.06640625f, 0.81640625f},
+    {0.07421875f, 0.75390625f, 0.13671875f, 0.81640625f},
+    {0.14453125f, 0.75390625f, 0.20703125f, 0.81640625f},
+    {0.21484375f, 0.75390625f, 0.27734375f, 0.81640625f},
+    {0.28515625f, 0.75390625f, 0.34765625f, 0.81640625f},
+    {0.35546875f, 0.75390625f, 0.41796875f, 0.81640625f},
+    {0.42578125f, 0.75390625f, 0.48828125f, 0.81640625f},
+    {0.49609375f, 0.75390625f, 0.55859375f, 0.81640625f},
+    {0.56640625f, 0.75390625f, 0.62890625f, 0.81640625f},
+    {0.63671875f, 0.75390625f, 0.69921875f, 0.81640625f},
+    {0.70703125f, 0.75390625f, 0.76953125f, 0.81640625f},
+    {0.77734375f, 0.75390625f, 0.83984375f, 0.81640625f},
+    {0.84765625f, 0.75390625f, 0.91015625f, 0.81640625f},
+    {0.91796875f, 0.75390625f, 0.98046875f, 0.81640625f},
+    {0.00390625f, 0.82421875f, 0.06640625f, 0.88671875f},
+    {0.07421875f, 0.82421875f, 0.13671875f, 0.88671875f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+    {0.40234375f, 0.26953125f, 0.46484375f, 0.33203125f},
+};
+
+// web/res/snake-graphics.png, row major
+constexpr int snakeColumns = 5;
+constexpr int snakeRows = 4;
+constexpr AtlasRect snakeRects[20] = {
+    {0.00390625f, 0.00390625f, 0.12890625f, 0.12890625f},
+    {0.13671875f, 0.00390625f, 0.26171875f, 0.12890625f},
+    {0.26953125f, 0.00390625f, 0.39453125f, 0.12890625f},
+    {0.40234375f, 0.00390625f, 0.52734375f, 0.12890625f},
+    {0.53515625f, 0.00390625f, 0.66015625f, 0.12890625f},
+    {0.66796875f, 0.00390625f, 0.79296875f, 0.12890625f},
+    {0.80078125f, 0.00390625f, 0.92578125f, 0.12890625f},
+    {0.00390625f, 0.13671875f, 0.12890625f, 0.26171875f},
+    {0.13671875f, 0.13671875f, 0.26171875f, 0.26171875f},
+    {0.26953125f, 0.13671875f, 0.39453125f, 0.26171875f},
+    {0.40234375f, 0.13671875f, 0.52734375f, 0.26171875f},
+    {0.80078125f, 0.00390625f, 0.92578125f, 0.12890625f},
+    {0.53515625f, 0.13671875f, 0.66015625f, 0.26171875f},
+    {0.66796875f, 0.13671875f, 0.79296875f, 0.26171875f},
+    {0.80078125f, 0.13671875f, 0.92578125f, 0.26171875f},
+    {0.00390625f, 0.26953125f, 0.12890625f, 0.39453125f},
+    {0.80078125f, 0.00390625f, 0.92578125f, 0.12890625f},
+    {0.80078125f, 0.00390625f, 0.92578125f, 0.12890625f},
+    {0.13671875f, 0.26953125f, 0.26171875f, 0.39453125f},
+    {0.26953125f, 0.26953125f, 0.39453125f, 0.39453125f},
+};
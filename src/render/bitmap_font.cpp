@@ -0,0 +1,223 @@
+#pragma once
+
+// Include after the GL and GLUT headers. Legacy GL, for the immediate mode
+// games (src/game.cpp, src/main.cpp).
+
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+
+// One GLUT bitmap font, measured and baked once at startup. Advances come
+// from a 256-entry table instead of glutBitmapWidth() per character, the
+// glyphs from a texture that glutBitmapCharacter() renders into through a
+// framebuffer object, so nothing depends on the window being mapped. Each distinct string is laid out once into a
+// display list of textured quads and looked up by hash afterwards, so
+// drawing text costs a glCallList however long it is.
+class BitmapFontAtlas
+{
+  static const int gridColumns = 16;
+  static const int padding = 2;   // glyphs may start left of the pen
+  static const int maxLayouts = 64; // cache is dropped once it grows past this
+
+  struct TextLayout
+  {
+    string text;
+    float width = 0.0f;
+    GLuint list = 0;
+  };
+
+  void *font = nullptr;
+  int advances[256] = {};
+  int cellWidth = 0, cellHeight = 0, baseline = 0;
+  int textureWidth = 0, textureHeight = 0;
+  GLuint texture = 0;
+  unordered_map<size_t, TextLayout> layouts;
+
+  static int nextPowerOfTwo(int value)
+  {
+    int size = 1;
+    while (size < value)
+      size <<= 1;
+    return size;
+  }
+
+  void clearLayouts()
+  {
+    for (auto &entry : layouts)
+      if (entry.second.list)
+        glDeleteLists(entry.second.list, 1);
+    layouts.clear();
+  }
+
+  void compile(TextLayout &layout)
+  {
+    glNewList(layout.list, GL_COMPILE);
+    glBegin(GL_QUADS);
+    float pen = 0.0f;
+    for (unsigned char c : layout.text)
+    {
+      float u1 = (float)(c % gridColumns * cellWidth) / textureWidth;
+      float v1 = (float)(c / gridColumns * cellHeight) / textureHeight;
+      float u2 = u1 + (float)cellWidth / textureWidth;
+      float v2 = v1 + (float)cellHeight / textureHeight;
+      float x1 = pen - padding, x2 = x1 + cellWidth;
+      float y1 = -baseline, y2 = y1 + cellHeight;
+      glTexCoord2f(u1, v1);
+      glVertex2f(x1, y1);
+      glTexCoord2f(u2, v1);
+      glVertex2f(x2, y1);
+      glTexCoord2f(u2, v2);
+      glVertex2f(x2, y2);
+      glTexCoord2f(u1, v2);
+      glVertex2f(x1, y2);
+      pen += advances[c];
+    }
+    glEnd();
+    glEndList();
+  }
+
+  public:
+    // Needs a current context and glutInit(), not a visible window. Returns
+    // false without framebuffer objects or if the grid does not fit a
+    // texture, text is then drawn glyph by glyph.
+    bool bake(void *glutFont)
+    {
+      font = glutFont;
+      int widest = 0;
+      for (int c = 0; c < 256; ++c)
+      {
+        advances[c] = glutBitmapWidth(font, c);
+        widest = max(widest, advances[c]);
+      }
+      cellWidth = widest + padding * 2;
+      cellHeight = glutBitmapHeight(font) + padding;
+      baseline = cellHeight / 4;
+
+      int gridWidth = gridColumns * cellWidth;
+      int gridHeight = 256 / gridColumns * cellHeight;
+      textureWidth = nextPowerOfTwo(gridWidth);
+      textureHeight = nextPowerOfTwo(gridHeight);
+      GLint maxSize = 0;
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+      if (!(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object) || textureWidth > maxSize || textureHeight > maxSize)
+        return false;
+
+      // White glyphs on transparent black. Modulated by the current colour
+      // this draws the same as an alpha texture.
+      GLuint baked;
+      glGenTextures(1, &baked);
+      glBindTexture(GL_TEXTURE_2D, baked);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+      GLint previous = 0;
+      glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+      GLuint framebuffer;
+      glGenFramebuffers(1, &framebuffer);
+      glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, baked, 0);
+      bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+      if (complete)
+      {
+        // Rows stay bottom up, like the texture's v
+        glPushAttrib(GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_VIEWPORT_BIT);
+        glViewport(0, 0, textureWidth, textureHeight);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+        for (int c = 1; c < 256; ++c)
+        {
+          glWindowPos2i(c % gridColumns * cellWidth + padding, c / gridColumns * cellHeight + baseline);
+          glutBitmapCharacter(font, c);
+        }
+        glPopAttrib();
+      }
+      glBindFramebuffer(GL_FRAMEBUFFER, previous);
+      glDeleteFramebuffers(1, &framebuffer);
+      if (!complete)
+      {
+        glDeleteTextures(1, &baked);
+        return false;
+      }
+
+      if (texture)
+        glDeleteTextures(1, &texture);
+      texture = baked;
+      clearLayouts();
+      return true;
+    }
+
+    bool isBaked() const
+    {
+      return texture != 0;
+    }
+
+    int advance(unsigned char c) const
+    {
+      return advances[c];
+    }
+
+    // Width in pixels, memoized with the layout
+    float width(const string &text)
+    {
+      return layout(text).width;
+    }
+
+    const TextLayout &layout(const string &text)
+    {
+      size_t key = hash<string>()(text);
+      auto found = layouts.find(key);
+      if (found != layouts.end() && found->second.text == text)
+        return found->second;
+
+      if (found == layouts.end() && (int)layouts.size() >= maxLayouts)
+        clearLayouts();
+      TextLayout &layout = layouts[key];
+      layout.text = text;
+      layout.width = 0.0f;
+      for (unsigned char c : text)
+        layout.width += advances[c];
+      if (isBaked())
+      {
+        if (!layout.list)
+          layout.list = glGenLists(1);
+        compile(layout);
+      }
+      return layout;
+    }
+
+    // Draws text with its baseline starting at (x, y); pixelWidth and
+    // pixelHeight convert pixels to the current coordinates. Uses the
+    // current colour, like glutBitmapCharacter.
+    void draw(float x, float y, const string &text, float pixelWidth, float pixelHeight)
+    {
+      if (!isBaked())
+      {
+        for (unsigned char c : text)
+        {
+          glRasterPos2f(x, y);
+          glutBitmapCharacter(font, c);
+          x += advances[c] * pixelWidth;
+        }
+        return;
+      }
+
+      GLuint list = layout(text).list;
+      glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT | GL_TRANSFORM_BIT);
+      glEnable(GL_TEXTURE_2D);
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glMatrixMode(GL_MODELVIEW);
+      glPushMatrix();
+      glTranslatef(x, y, 0.0f);
+      glScalef(pixelWidth, pixelHeight, 1.0f);
+      glCallList(list);
+      glPopMatrix();
+      glPopAttrib();
+    }
+};
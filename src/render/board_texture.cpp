@@ -0,0 +1,163 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <vector>
+#include "quad_ring.cpp"
+#include "chunked_board.cpp"
+#include "snake_sprites.cpp"
+
+using namespace std;
+
+// The board as a columns x rows texture of cell states (luminance) and
+// sprite indices (alpha), drawn with one fullscreen quad whose fragment
+// shader looks up the cell under each pixel. A tick only rewrites the
+// texels it changed, so neither the upload nor the draw grows with the
+// snake's length or the board's size.
+class BoardTexture
+{
+  GLuint texture = 0;
+  GLuint quad = 0;
+  GLint posLoc = -1, viewLoc = -1, boardSizeLoc = -1, wrapLoc = -1;
+  int columns = 0, rows = 0;
+  vector<unsigned char> counts; // Segments per cell, the tail doubles up after eating
+  Cell fruit = {-1, -1};
+
+  unsigned char &countAt(const Cell &cell)
+  {
+    return counts[(size_t)cell.y * columns + cell.x];
+  }
+
+  void writeTexel(const Cell &cell, CellState state, int sprite)
+  {
+    unsigned char texel[2] = {(unsigned char)state, (unsigned char)sprite};
+    glTexSubImage2D(GL_TEXTURE_2D, 0, cell.x, cell.y, 1, 1, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, texel);
+    uploadStats.frameBytes += sizeof(texel);
+    uploadStats.totalBytes += sizeof(texel);
+  }
+
+  void writeSegment(const SnakeGame &game, const vector<unsigned char> &sprites, size_t index)
+  {
+    writeTexel(game.snakeBody[index], index == 0 ? CELL_HEAD : CELL_BODY, sprites[index]);
+  }
+
+  void rebuild(const SnakeGame &game, const vector<unsigned char> &sprites)
+  {
+    fill(counts.begin(), counts.end(), 0);
+    vector<unsigned char> texels((size_t)columns * rows * 2, 0);
+    fruit = game.fruit;
+    texels[((size_t)fruit.y * columns + fruit.x) * 2] = CELL_FRUIT;
+    texels[((size_t)fruit.y * columns + fruit.x) * 2 + 1] = fruitSprite;
+    for (size_t i = game.snakeBody.size(); i-- > 0;)
+    {
+      const Cell &cell = game.snakeBody[i];
+      countAt(cell)++;
+      texels[((size_t)cell.y * columns + cell.x) * 2] = i == 0 ? CELL_HEAD : CELL_BODY;
+      texels[((size_t)cell.y * columns + cell.x) * 2 + 1] = sprites[i];
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, columns, rows, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, texels.data());
+    uploadStats.frameBytes += texels.size();
+    uploadStats.totalBytes += texels.size();
+    uploadStats.fullUploads++;
+  }
+
+  public:
+    // Boards larger than the GPU's texture limit have to use ChunkedBoard
+    static bool fits(int boardColumns, int boardRows)
+    {
+      GLint maxSize = 0;
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+      return boardColumns <= maxSize && boardRows <= maxSize;
+    }
+
+    void init(int boardColumns, int boardRows)
+    {
+      columns = boardColumns;
+      rows = boardRows;
+      counts.assign((size_t)columns * rows, 0);
+      fruit = {-1, -1};
+      if (!texture)
+        glGenTextures(1, &texture);
+      glBindTexture(GL_TEXTURE_2D, texture);
+      // Wrapping happens in the shader, GLES2 cannot repeat NPOT textures
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      if (!quad)
+      {
+        Quad screen = makeQuad(-1.0f, -1.0f, 2.0f, 2.0f);
+        glGenBuffers(1, &quad);
+        glBindBuffer(GL_ARRAY_BUFFER, quad);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(screen), &screen, GL_STATIC_DRAW);
+      }
+    }
+
+    // Looks up the locations draw() sets in the board program once
+    void bind(GLuint program)
+    {
+      posLoc = glGetAttribLocation(program, "aPosition");
+      viewLoc = glGetUniformLocation(program, "uView");
+      boardSizeLoc = glGetUniformLocation(program, "uBoardSize");
+      wrapLoc = glGetUniformLocation(program, "uWrap");
+    }
+
+    // Applies the game's pending delta. Cells emptied by an op are cleared
+    // using the occupancy counts, then the segments whose tile depends on
+    // neighbours that moved (new heads, the neck and the tail) are written
+    // on top. sprites holds snakeSpriteAt() for every segment.
+    void sync(const SnakeGame &game, const vector<unsigned char> &sprites)
+    {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      if (game.delta.reset)
+      {
+        rebuild(game, sprites);
+        return;
+      }
+
+      size_t headsPushed = 0;
+      for (const auto &entry : game.delta.ops)
+      {
+        unsigned char &count = countAt(entry.cell);
+        headsPushed += entry.op == PUSH_HEAD;
+        if (entry.op != POP_TAIL)
+          count++;
+        else if (count > 0 && --count == 0)
+          writeTexel(entry.cell, CELL_EMPTY, 0);
+      }
+
+      if (game.delta.fruitMoved)
+      {
+        if (countAt(fruit) == 0)
+          writeTexel(fruit, CELL_EMPTY, 0);
+        fruit = game.fruit;
+        writeTexel(fruit, CELL_FRUIT, fruitSprite);
+      }
+
+      if (game.delta.ops.empty())
+        return;
+      // Every head pushed since the last sync is a body segment now
+      size_t last = game.snakeBody.size() - 1;
+      writeSegment(game, sprites, last);
+      for (size_t i = min(headsPushed, last); i > 0; --i)
+        writeSegment(game, sprites, i);
+      writeSegment(game, sprites, 0);
+    }
+
+    // The bound program's vertex shader maps the quad onto the camera's
+    // view (uView: left, bottom, width, height in cells); uBoardSize and
+    // uWrap tell the fragment shader how to fold cells back onto the board
+    void draw(const Camera &camera)
+    {
+      glUniform4f(viewLoc, camera.x - camera.viewColumns / 2.0f, camera.y - camera.viewRows / 2.0f, camera.viewColumns, camera.viewRows);
+      glUniform2f(boardSizeLoc, columns, rows);
+      glUniform1i(wrapLoc, !camera.showsWholeBoard(columns, rows));
+
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glBindBuffer(GL_ARRAY_BUFFER, quad);
+      glEnableVertexAttribArray(posLoc);
+      glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)0);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      glDisableVertexAttribArray(posLoc);
+    }
+};
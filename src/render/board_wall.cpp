@@ -0,0 +1,182 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "quad_ring.cpp"
+#include "../batch_simulation.cpp"
+
+using namespace std;
+
+// The whole wall is one quad; every pixel works out its board and cell
+// (uGrid boards of uBoardSize cells) and looks both up
+const char *wallVertexShaderSource = R"(
+    attribute vec2 aPosition;
+    uniform vec2 uGrid;
+    uniform vec2 uScale;
+    varying vec2 vWall;
+
+    void main() {
+        vWall = (aPosition * 0.5 + 0.5) * uGrid;
+        gl_Position = vec4(aPosition * uScale, 0.0, 1.0);
+    }
+)";
+
+const char *wallFragmentShaderSource = R"(
+  #ifdef GL_FRAGMENT_PRECISION_HIGH
+  precision highp float;
+  #else
+  precision mediump float;
+  #endif
+  uniform sampler2D uCells;
+  uniform sampler2D uTints;
+  uniform vec2 uGrid;
+  uniform vec2 uBoardSize;
+  uniform float uGutter; // fraction of a board left dark on each side
+  varying vec2 vWall;
+
+  // Branchless like the board shader, llvmpipe pays for every branch
+  void main() {
+    vec2 board = floor(vWall);
+    vec2 local = (fract(vWall) - uGutter) / (1.0 - 2.0 * uGutter);
+    vec2 inside = step(0.0, local) * (1.0 - step(1.0, local));
+    vec2 cell = floor(clamp(local, 0.0, 0.999) * uBoardSize);
+    float state = texture2D(uCells, (board * uBoardSize + cell + 0.5) / (uGrid * uBoardSize)).r * 255.0;
+    vec3 tint = texture2D(uTints, (board + 0.5) / uGrid).rgb;
+    float snake = step(0.5, state) * (1.0 - step(2.5, state));
+    vec3 color = mix(tint * 0.15, tint, snake);
+    color = mix(color, vec3(1.0), step(1.5, state) * snake); // CELL_HEAD
+    color = mix(color, vec3(1.0, 1.0, 0.0), step(2.5, state)); // CELL_FRUIT
+    gl_FragColor = vec4(color * inside.x * inside.y, 1.0);
+  }
+)";
+
+// Renders a WallSnapshot with a single draw: the cells of every board in
+// one luminance texture and a colour per board in a second, tiny one. GLES2
+// has no instancing, so the per-board offset comes from the fragment's
+// position instead of an instance attribute. Uploads happen once per
+// snapshot, frames in between only redraw.
+class BoardWall
+{
+  GLuint cells = 0, tints = 0, quad = 0;
+  GLint posLoc = -1, gridLoc = -1, boardSizeLoc = -1, scaleLoc = -1, gutterLoc = -1;
+  int boards = 0, gridColumns = 0, gridRows = 0, columns = 0, rows = 0;
+  vector<unsigned char> palette;   // RGB per board
+  vector<unsigned char> tintTexels; // palette dimmed for finished games
+
+  static GLuint createTexture()
+  {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+  }
+
+  // Hues a golden angle apart, so neighbouring boards never look alike
+  static void boardColor(int index, unsigned char *rgb)
+  {
+    float hue = fmod(index * 0.618034f, 1.0f) * 6.0f;
+    for (int channel = 0; channel < 3; ++channel)
+    {
+      float distance = fabs(fmod(hue + 4.0f - channel * 2.0f, 6.0f) - 3.0f);
+      rgb[channel] = (unsigned char)(255.0f * (0.35f + 0.65f * min(max(distance - 1.0f, 0.0f), 1.0f)));
+    }
+  }
+
+  public:
+    float gutter = 0.05f;
+
+    static bool fits(const BatchSimulation &batch, int boardColumns, int boardRows)
+    {
+      GLint maxSize = 0;
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+      return batch.wallColumns() * boardColumns <= maxSize && batch.wallRows() * boardRows <= maxSize;
+    }
+
+    void init(int wallBoards, int wallColumns, int wallRows, int boardColumns, int boardRows)
+    {
+      boards = wallBoards;
+      gridColumns = wallColumns;
+      gridRows = wallRows;
+      columns = boardColumns;
+      rows = boardRows;
+      palette.assign((size_t)boards * 3, 0);
+      for (int i = 0; i < boards; ++i)
+        boardColor(i, &palette[i * 3]);
+      tintTexels.assign((size_t)gridColumns * gridRows * 3, 0);
+
+      if (!cells)
+        cells = createTexture();
+      glBindTexture(GL_TEXTURE_2D, cells);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, gridColumns * columns, gridRows * rows, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, nullptr);
+      if (!tints)
+        tints = createTexture();
+      glBindTexture(GL_TEXTURE_2D, tints);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, gridColumns, gridRows, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+      if (!quad)
+      {
+        Quad screen = makeQuad(-1.0f, -1.0f, 2.0f, 2.0f);
+        glGenBuffers(1, &quad);
+        glBindBuffer(GL_ARRAY_BUFFER, quad);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(screen), &screen, GL_STATIC_DRAW);
+      }
+    }
+
+    // Looks up the locations draw() sets in the wall program once
+    void bind(GLuint program)
+    {
+      posLoc = glGetAttribLocation(program, "aPosition");
+      gridLoc = glGetUniformLocation(program, "uGrid");
+      boardSizeLoc = glGetUniformLocation(program, "uBoardSize");
+      scaleLoc = glGetUniformLocation(program, "uScale");
+      gutterLoc = glGetUniformLocation(program, "uGutter");
+    }
+
+    void upload(const WallSnapshot &snapshot)
+    {
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      glBindTexture(GL_TEXTURE_2D, cells);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, gridColumns * columns, gridRows * rows, GL_LUMINANCE, GL_UNSIGNED_BYTE, snapshot.cells.data());
+
+      for (int i = 0; i < boards; ++i)
+      {
+        unsigned char *texel = &tintTexels[((size_t)(gridRows - 1 - i / gridColumns) * gridColumns + i % gridColumns) * 3];
+        int shift = snapshot.running[i] ? 0 : 2; // finished games at a quarter
+        for (int channel = 0; channel < 3; ++channel)
+          texel[channel] = palette[i * 3 + channel] >> shift;
+      }
+      glBindTexture(GL_TEXTURE_2D, tints);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, gridColumns, gridRows, GL_RGB, GL_UNSIGNED_BYTE, tintTexels.data());
+
+      size_t bytes = snapshot.cells.size() + tintTexels.size();
+      uploadStats.frameBytes += bytes;
+      uploadStats.totalBytes += bytes;
+    }
+
+    // Fits the wall into the viewport (aspect width / height) with square
+    // cells. The bound program is built from the wall shaders and in use,
+    // with uCells on texture unit 0 and uTints on unit 1.
+    void draw(float aspect)
+    {
+      float wallAspect = (float)(gridColumns * columns) / (gridRows * rows);
+      glUniform2f(gridLoc, gridColumns, gridRows);
+      glUniform2f(boardSizeLoc, columns, rows);
+      glUniform2f(scaleLoc, min(wallAspect / aspect, 1.0f), min(aspect / wallAspect, 1.0f));
+      glUniform1f(gutterLoc, gutter);
+
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, tints);
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, cells);
+      glBindBuffer(GL_ARRAY_BUFFER, quad);
+      glEnableVertexAttribArray(posLoc);
+      glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)0);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      glDisableVertexAttribArray(posLoc);
+    }
+};
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "quad_ring.cpp"
+#include "../simulation.cpp"
+
+using namespace std;
+
+// Which part of the board is on screen, in cells. The camera follows the
+// snake's head; boards that fit into the view stay fixed and centred.
+struct Camera
+{
+  float x = 0.0f, y = 0.0f;
+  float viewColumns = 40.0f, viewRows = 40.0f;
+
+  bool showsWholeBoard(int columns, int rows) const
+  {
+    return columns <= viewColumns && rows <= viewRows;
+  }
+
+  void follow(const SnakeGame &game)
+  {
+    if (game.snakeBody.empty())
+      follow(game, 0.0f, 0.0f);
+    else
+      follow(game, game.snakeBody[0].x, game.snakeBody[0].y);
+  }
+
+  // Follows a head drawn between cells, for interpolated rendering
+  void follow(const SnakeGame &game, float headX, float headY)
+  {
+    if (showsWholeBoard(game.columns, game.rows) || game.snakeBody.empty())
+    {
+      x = game.columns / 2.0f;
+      y = game.rows / 2.0f;
+      return;
+    }
+    x = headX + 0.5f;
+    y = headY + 0.5f;
+  }
+
+  // Scale and offset taking cell coordinates of the board copy at
+  // (offsetX, offsetY) to NDC, for the uTransform uniform
+  void transform(int offsetX, int offsetY, float out[4]) const
+  {
+    out[0] = 2.0f / viewColumns;
+    out[1] = 2.0f / viewRows;
+    out[2] = (offsetX - x) * out[0];
+    out[3] = (offsetY - y) * out[1];
+  }
+};
+
+// The board wraps, so near an edge the view also shows the opposite side.
+// Returns the cell offsets of every board copy the view overlaps.
+vector<Cell> visibleBoardCopies(const Camera &camera, int columns, int rows)
+{
+  if (camera.showsWholeBoard(columns, rows))
+    return {{0, 0}};
+
+  int firstX = (int)floor((camera.x - camera.viewColumns / 2.0f) / columns);
+  int lastX = (int)floor((camera.x + camera.viewColumns / 2.0f) / columns);
+  int firstY = (int)floor((camera.y - camera.viewRows / 2.0f) / rows);
+  int lastY = (int)floor((camera.y + camera.viewRows / 2.0f) / rows);
+
+  vector<Cell> copies;
+  for (int copyY = firstY; copyY <= lastY; ++copyY)
+    for (int copyX = firstX; copyX <= lastX; ++copyX)
+      copies.push_back({copyX * columns, copyY * rows});
+  return copies;
+}
+
+// Occupancy of the whole board split into square chunks, each with its own
+// vertex buffer of cell quads. Every occupied cell owns a slot in its
+// chunk's buffer; a cell that fills or empties patches just that slot with
+// glBufferSubData, and emptied slots go on a free list for reuse. Drawing
+// culls to the chunks inside the view and applies pending changes only
+// among them, so the cost of a frame follows what is visible rather than the
+// size of the board. Cell storage and buffers are allocated the first time a
+// chunk is touched, and a buffer is only reallocated when its chunk
+// outgrows it.
+class ChunkedBoard
+{
+  static const int chunkSize = 32;
+
+  struct Chunk
+  {
+    vector<unsigned char> cells; // Segments per cell, the tail doubles up after eating
+    vector<short> slots;         // Buffer slot per cell, -1 when it has none
+    vector<short> freeSlots;
+    vector<short> changed;       // Cells that filled or emptied since the last draw
+    int occupied = 0;
+    GLuint vbo = 0;
+    int capacity = 0; // Slots the buffer holds
+    int quads = 0;    // Slots in use or free, the range drawn
+    bool rebuildAll = false;
+  };
+
+  int columns = 0, rows = 0;
+  int chunksX = 0, chunksY = 0;
+  vector<Chunk> chunks;
+
+  Chunk &chunkAt(const Cell &cell)
+  {
+    return chunks[(cell.y / chunkSize) * chunksX + cell.x / chunkSize];
+  }
+
+  Quad quadAt(int chunkX, int chunkY, int index) const
+  {
+    return makeQuad(chunkX * chunkSize + index % chunkSize, chunkY * chunkSize + index / chunkSize, 1.0f, 1.0f);
+  }
+
+  void uploadSlot(int slot, const Quad &quad)
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, slot * sizeof(Quad), sizeof(Quad), &quad);
+    uploadStats.frameBytes += sizeof(Quad);
+    uploadStats.totalBytes += sizeof(Quad);
+  }
+
+  // Packs every occupied cell into the first slots, growing the buffer when
+  // they no longer fit
+  void rebuild(int chunkX, int chunkY, Chunk &chunk)
+  {
+    vector<Quad> quads;
+    quads.reserve(chunk.occupied);
+    fill(chunk.slots.begin(), chunk.slots.end(), -1);
+    for (int index = 0; index < (int)chunk.cells.size() && (int)quads.size() < chunk.occupied; ++index)
+    {
+      if (!chunk.cells[index])
+        continue;
+      chunk.slots[index] = quads.size();
+      quads.push_back(quadAt(chunkX, chunkY, index));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+    if ((int)quads.size() > chunk.capacity)
+    {
+      chunk.capacity = min(max(16, (int)quads.size() * 2), chunkSize * chunkSize);
+      glBufferData(GL_ARRAY_BUFFER, chunk.capacity * sizeof(Quad), nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (!quads.empty())
+      glBufferSubData(GL_ARRAY_BUFFER, 0, quads.size() * sizeof(Quad), quads.data());
+    uploadStats.frameBytes += quads.size() * sizeof(Quad);
+    uploadStats.totalBytes += quads.size() * sizeof(Quad);
+    chunk.quads = quads.size();
+    chunk.freeSlots.clear();
+    chunk.changed.clear();
+    chunk.rebuildAll = false;
+    rebuiltChunks++;
+  }
+
+  // Patches the slots of the cells that changed, or rebuilds when a cell
+  // needs a slot beyond the buffer
+  void update(int chunkX, int chunkY, Chunk &chunk)
+  {
+    if (chunk.rebuildAll)
+    {
+      rebuild(chunkX, chunkY, chunk);
+      return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+    for (short index : chunk.changed)
+    {
+      short &slot = chunk.slots[index];
+      if (chunk.cells[index] && slot < 0)
+      {
+        if (!chunk.freeSlots.empty())
+        {
+          slot = chunk.freeSlots.back();
+          chunk.freeSlots.pop_back();
+        }
+        else if (chunk.quads < chunk.capacity)
+        {
+          slot = chunk.quads++;
+        }
+        else
+        {
+          rebuild(chunkX, chunkY, chunk);
+          return;
+        }
+        uploadSlot(slot, quadAt(chunkX, chunkY, index));
+      }
+      else if (!chunk.cells[index] && slot >= 0)
+      {
+        // A zero sized quad draws nothing
+        uploadSlot(slot, makeQuad(0.0f, 0.0f, 0.0f, 0.0f));
+        chunk.freeSlots.push_back(slot);
+        slot = -1;
+      }
+    }
+    chunk.changed.clear();
+    patchedChunks++;
+  }
+
+  void touch(Chunk &chunk)
+  {
+    if (!chunk.cells.empty())
+      return;
+    chunk.cells.assign(chunkSize * chunkSize, 0);
+    chunk.slots.assign(chunkSize * chunkSize, -1);
+    chunk.rebuildAll = true;
+  }
+
+  // A chunk that keeps changing off screen is rebuilt rather than queueing
+  // without bound
+  void markChanged(Chunk &chunk, int index)
+  {
+    if (chunk.rebuildAll)
+      return;
+    chunk.changed.push_back(index);
+    if ((int)chunk.changed.size() > chunkSize * chunkSize)
+    {
+      chunk.changed.clear();
+      chunk.rebuildAll = true;
+    }
+  }
+
+  public:
+    // Per frame, reset by the caller
+    int drawnChunks = 0;
+    int rebuiltChunks = 0;
+    int patchedChunks = 0;
+
+    void init(int boardColumns, int boardRows)
+    {
+      for (auto &chunk : chunks)
+        if (chunk.vbo)
+          glDeleteBuffers(1, &chunk.vbo);
+      columns = boardColumns;
+      rows = boardRows;
+      chunksX = (columns + chunkSize - 1) / chunkSize;
+      chunksY = (rows + chunkSize - 1) / chunkSize;
+      chunks.assign((size_t)chunksX * chunksY, Chunk());
+      // Names only, a chunk's storage is allocated when the snake first
+      // enters it, but no frame has to create a buffer
+      vector<GLuint> names(chunks.size());
+      glGenBuffers(names.size(), names.data());
+      for (size_t i = 0; i < chunks.size(); ++i)
+        chunks[i].vbo = names[i];
+    }
+
+    // Empties every chunk that was ever written to; they are rebuilt in
+    // full, which only resets do
+    void clear()
+    {
+      for (auto &chunk : chunks)
+      {
+        if (chunk.occupied == 0 && chunk.quads == 0)
+          continue;
+        fill(chunk.cells.begin(), chunk.cells.end(), 0);
+        chunk.occupied = 0;
+        chunk.rebuildAll = true;
+        chunk.changed.clear();
+      }
+    }
+
+    void add(const Cell &cell)
+    {
+      Chunk &chunk = chunkAt(cell);
+      touch(chunk);
+      int index = (cell.y % chunkSize) * chunkSize + cell.x % chunkSize;
+      if (chunk.cells[index]++ == 0)
+      {
+        chunk.occupied++;
+        markChanged(chunk, index);
+      }
+    }
+
+    void remove(const Cell &cell)
+    {
+      Chunk &chunk = chunkAt(cell);
+      if (chunk.cells.empty())
+        return;
+      int index = (cell.y % chunkSize) * chunkSize + cell.x % chunkSize;
+      if (chunk.cells[index] == 0)
+        return;
+      if (--chunk.cells[index] == 0)
+      {
+        chunk.occupied--;
+        markChanged(chunk, index);
+      }
+    }
+
+    // Changes to chunks outside the view wait until they scroll in
+    void draw(const Camera &camera, GLint posLoc, GLint transformLoc)
+    {
+      float halfColumns = camera.viewColumns / 2.0f;
+      float halfRows = camera.viewRows / 2.0f;
+      float transform[4];
+      for (const Cell &copy : visibleBoardCopies(camera, columns, rows))
+      {
+        // The view in this copy's cell coordinates, clamped to the board
+        float left = max(camera.x - halfColumns - copy.x, 0.0f);
+        float right = min(camera.x + halfColumns - copy.x, (float)columns);
+        float bottom = max(camera.y - halfRows - copy.y, 0.0f);
+        float top = min(camera.y + halfRows - copy.y, (float)rows);
+        if (left >= right || bottom >= top)
+          continue;
+
+        camera.transform(copy.x, copy.y, transform);
+        glUniform4fv(transformLoc, 1, transform);
+
+        int firstX = (int)left / chunkSize, lastX = (int)ceil(right / chunkSize) - 1;
+        int firstY = (int)bottom / chunkSize, lastY = (int)ceil(top / chunkSize) - 1;
+        for (int chunkY = firstY; chunkY <= lastY; ++chunkY)
+        {
+          for (int chunkX = firstX; chunkX <= lastX; ++chunkX)
+          {
+            Chunk &chunk = chunks[chunkY * chunksX + chunkX];
+            if (chunk.rebuildAll || !chunk.changed.empty())
+              update(chunkX, chunkY, chunk);
+            if (chunk.quads == 0)
+              continue;
+
+            glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+            glEnableVertexAttribArray(posLoc);
+            glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)0);
+            glDrawArrays(GL_TRIANGLES, 0, chunk.quads * 6);
+            drawnChunks++;
+          }
+        }
+      }
+      glDisableVertexAttribArray(posLoc);
+
+      // Back to NDC for everything else
+      glUniform4f(transformLoc, 1.0f, 1.0f, 0.0f, 0.0f);
+    }
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+// Include after the GL headers
+
+#include <iostream>
+#include <string>
+#include "../utils/texture_file.cpp"
+
+using namespace std;
+
+// Uploads every level of a precooked texture straight from the mapping.
+// Returns 0 when the file is missing, not a valid .tex, or was cooked from
+// something other than the current sourcePath, so callers can fall back to
+// decoding the source image. An empty sourcePath skips that check. Callers
+// that blend straight alpha pass straightAlpha, and a premultiplied file is
+// then turned down, with a warning, before anything is uploaded.
+GLuint loadCookedTexture(const string &path, const string &sourcePath, bool straightAlpha = false)
+{
+  MappedTexture file;
+  if (!mapTextureFile(path, file))
+    return 0;
+  bool rejected = !sourcePath.empty() && !textureMatchesSource(*file.header, sourcePath);
+  if (!rejected && straightAlpha && (file.header->flags & TEXTURE_PREMULTIPLIED))
+  {
+    cerr << path << " is premultiplied, loading " << (sourcePath.empty() ? "the source image" : sourcePath) << " instead" << endl;
+    rejected = true;
+  }
+  if (rejected)
+  {
+    unmapTextureFile(file);
+    return 0;
+  }
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  for (uint32_t level = 0; level < file.header->mipCount; ++level)
+  {
+    const TextureFileMip &mip = file.mips[level];
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, file.bytes + mip.offset);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, file.header->mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  unmapTextureFile(file);
+  return texture;
+}
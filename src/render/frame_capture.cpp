@@ -0,0 +1,292 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../utils/spsc_queue.cpp"
+#include "../utils/image.cpp"
+
+using namespace std;
+
+enum CaptureFormat
+{
+  CAPTURE_Y4M,
+  CAPTURE_PNG
+};
+
+// A path ending in .y4m is one video file, anything else a directory for a
+// PNG sequence
+CaptureFormat captureFormatFor(const string &path)
+{
+  if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0)
+    return CAPTURE_Y4M;
+  return CAPTURE_PNG;
+}
+
+// Records frames to disk without stalling the game loop. Frames go into a
+// pool of preallocated RGBA buffers; the game thread hands filled buffers to
+// a background writer through one lock-free queue and gets them back through
+// another. When the writer falls behind and the pool is exhausted the frame
+// is dropped and counted instead of waiting. The writer sleeps on a
+// condition variable until a frame is submitted. Frames it cannot get onto
+// disk are counted as failed.
+class FrameCapture
+{
+  static const int maxPoolSize = 64;
+
+  vector<vector<unsigned char>> pool;
+  SpscQueue<int> freeBuffers{maxPoolSize};  // writer -> game
+  SpscQueue<int> readyBuffers{maxPoolSize}; // game -> writer
+  int acquired = -1;
+
+  thread writer;
+  mutex wakeMutex;
+  condition_variable wake;
+  bool stopping = false; // guarded by wakeMutex
+  bool active = false;
+
+  string path;
+  CaptureFormat format = CAPTURE_Y4M;
+  int width = 0, height = 0;
+  bool bottomUp = false;
+  FILE *video = nullptr;
+  vector<unsigned char> yuv;
+
+  // RGBA to 4:2:0 full range BT.601, as Y4M's C420jpeg expects
+  bool writeY4MFrame(const vector<unsigned char> &rgba)
+  {
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    unsigned char *planeY = yuv.data();
+    unsigned char *planeU = planeY + (size_t)width * height;
+    unsigned char *planeV = planeU + (size_t)chromaWidth * chromaHeight;
+
+    for (int i = 0; i < height; ++i)
+    {
+      const unsigned char *src = &rgba[(size_t)(bottomUp ? height - 1 - i : i) * width * 4];
+      for (int x = 0; x < width; ++x)
+      {
+        int r = src[x * 4], g = src[x * 4 + 1], b = src[x * 4 + 2];
+        planeY[(size_t)i * width + x] = (unsigned char)((77 * r + 150 * g + 29 * b + 128) >> 8);
+      }
+    }
+
+    for (int cy = 0; cy < chromaHeight; ++cy)
+    {
+      for (int cx = 0; cx < chromaWidth; ++cx)
+      {
+        int r = 0, g = 0, b = 0, samples = 0;
+        for (int dy = 0; dy < 2 && cy * 2 + dy < height; ++dy)
+        {
+          int row = cy * 2 + dy;
+          const unsigned char *src = &rgba[(size_t)(bottomUp ? height - 1 - row : row) * width * 4];
+          for (int dx = 0; dx < 2 && cx * 2 + dx < width; ++dx)
+          {
+            const unsigned char *px = src + (cx * 2 + dx) * 4;
+            r += px[0];
+            g += px[1];
+            b += px[2];
+            samples++;
+          }
+        }
+        r /= samples;
+        g /= samples;
+        b /= samples;
+        planeU[(size_t)cy * chromaWidth + cx] = (unsigned char)((-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8);
+        planeV[(size_t)cy * chromaWidth + cx] = (unsigned char)((128 * r - 107 * g - 21 * b + 32768 + 128) >> 8);
+      }
+    }
+
+    // stdio buffers the file, a full disk may only show up when stop() flushes
+    return fputs("FRAME\n", video) >= 0 && fwrite(yuv.data(), 1, yuv.size(), video) == yuv.size();
+  }
+
+  void writeFrame(const vector<unsigned char> &rgba)
+  {
+    bool written;
+    if (format == CAPTURE_Y4M)
+    {
+      written = writeY4MFrame(rgba);
+    }
+    else
+    {
+      // Numbered in capture order, failed frames leave a gap
+      char name[32];
+      snprintf(name, sizeof(name), "/frame_%06lu.png", (unsigned long)(writtenFrames + failedFrames));
+      written = writePNG(path + name, rgba.data(), width, height, bottomUp);
+      if (!written)
+        remove((path + name).c_str()); // a truncated PNG is worse than none
+    }
+    if (written)
+      writtenFrames++;
+    else
+      failedFrames++;
+  }
+
+  // Writes until stop() was called and everything submitted before it is
+  // on disk
+  void writerLoop()
+  {
+    int index;
+    unique_lock<mutex> lock(wakeMutex);
+    while (true)
+    {
+      lock.unlock();
+      while (readyBuffers.pop(index))
+      {
+        writeFrame(pool[index]);
+        freeBuffers.push(index);
+      }
+      lock.lock();
+      if (readyBuffers.size() > 0)
+        continue;
+      if (stopping)
+        break;
+      wake.wait(lock);
+    }
+  }
+
+  public:
+    atomic<unsigned long> capturedFrames{0};
+    atomic<unsigned long> writtenFrames{0};
+    atomic<unsigned long> droppedFrames{0};
+    atomic<unsigned long> failedFrames{0}; // captured but not written
+    bool closeFailed = false; // the video's last flush or close failed, stop() sets it
+
+    ~FrameCapture()
+    {
+      stop();
+    }
+
+    bool start(const string &outputPath, int frameWidth, int frameHeight, int fps, bool rowsBottomUp, int poolSize = 8)
+    {
+      stop();
+      path = outputPath;
+      format = captureFormatFor(path);
+      width = frameWidth;
+      height = frameHeight;
+      bottomUp = rowsBottomUp;
+
+      if (format == CAPTURE_Y4M)
+      {
+        video = fopen(path.c_str(), "wb");
+        if (!video)
+          return false;
+        if (fprintf(video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps) < 0 || fflush(video) != 0)
+        {
+          fclose(video);
+          video = nullptr;
+          return false;
+        }
+        yuv.resize((size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2));
+      }
+      else
+      {
+        // Better to fail here than to lose every frame later
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || access(path.c_str(), W_OK) != 0)
+          return false;
+      }
+
+      poolSize = max(1, min(poolSize, (int)maxPoolSize));
+      pool.assign(poolSize, vector<unsigned char>((size_t)width * height * 4));
+      int index;
+      while (freeBuffers.pop(index))
+        ;
+      for (int i = 0; i < poolSize; ++i)
+        freeBuffers.push(i);
+
+      capturedFrames = 0;
+      writtenFrames = 0;
+      droppedFrames = 0;
+      failedFrames = 0;
+      closeFailed = false;
+      stopping = false;
+      active = true;
+      writer = thread(&FrameCapture::writerLoop, this);
+      return true;
+    }
+
+    bool isActive() const
+    {
+      return active;
+    }
+
+    const string &outputPath() const
+    {
+      return path;
+    }
+
+    // Returns a buffer of width * height RGBA pixels to render or read back
+    // into, or null (and counts a drop) when every buffer is still queued.
+    // Offline producers can pass wait to apply back-pressure instead.
+    unsigned char *acquireFrame(bool wait = false)
+    {
+      if (!active)
+        return nullptr;
+      while (acquired < 0 && !freeBuffers.pop(acquired))
+      {
+        acquired = -1;
+        if (!wait)
+        {
+          droppedFrames++;
+          return nullptr;
+        }
+        this_thread::yield();
+      }
+      return pool[acquired].data();
+    }
+
+    void submitFrame()
+    {
+      if (acquired < 0)
+        return;
+      readyBuffers.push(acquired);
+      acquired = -1;
+      capturedFrames++;
+      lock_guard<mutex> lock(wakeMutex);
+      wake.notify_one();
+    }
+
+    // Copying variant for renderers that own their framebuffer
+    bool captureFrame(const unsigned char *rgba, bool wait = false)
+    {
+      unsigned char *buffer = acquireFrame(wait);
+      if (!buffer)
+        return false;
+      copy(rgba, rgba + (size_t)width * height * 4, buffer);
+      submitFrame();
+      return true;
+    }
+
+    // Flushes queued frames and closes the output
+    void stop()
+    {
+      if (!active)
+        return;
+      // An acquired but unsubmitted buffer is simply forgotten, start()
+      // refills the free queue from scratch
+      acquired = -1;
+      {
+        lock_guard<mutex> lock(wakeMutex);
+        stopping = true;
+      }
+      wake.notify_one();
+      writer.join();
+      if (video)
+      {
+        // Frames are only known to be on disk once this succeeds
+        bool flushed = fflush(video) == 0;
+        closeFailed = fclose(video) != 0 || !flushed;
+        video = nullptr;
+      }
+      active = false;
+    }
+};
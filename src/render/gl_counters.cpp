@@ -0,0 +1,386 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+// Driver work per frame, counted by an interposer over the GL entry points
+// the game uses: every wrapper below bumps a counter and calls the real
+// function, and the macros after them route the rest of the program through
+// the wrappers. Include right after the GL headers, before anything that
+// calls GL. Building with -DNO_GL_COUNTERS leaves the calls alone and the
+// counters at zero. The frame loop reads the counters and then resets them.
+struct GLCounters
+{
+  uint64_t drawCalls = 0;
+  uint64_t buffersCreated = 0;
+  uint64_t buffersDeleted = 0;
+  uint64_t texturesCreated = 0;
+  uint64_t texturesDeleted = 0;
+  uint64_t uploadBytes = 0;  // buffer data and texels handed to the driver
+  uint64_t stateChanges = 0; // binds, enables, attribute setup, blending
+  uint64_t uniformUpdates = 0;
+};
+GLCounters glCounters;
+
+// Bytes per texel of an uncompressed format, for counting texture uploads
+size_t glTexelBytes(GLenum format, GLenum type)
+{
+  if (type == GL_UNSIGNED_SHORT_5_6_5 || type == GL_UNSIGNED_SHORT_4_4_4_4 || type == GL_UNSIGNED_SHORT_5_5_5_1)
+    return 2;
+  switch (format)
+  {
+  case GL_RGBA:
+    return 4;
+  case GL_RGB:
+    return 3;
+  case GL_LUMINANCE_ALPHA:
+    return 2;
+  default:
+    return 1;
+  }
+}
+
+void countedDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+  glCounters.drawCalls++;
+  glDrawArrays(mode, first, count);
+}
+
+void countedDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+  glCounters.drawCalls++;
+  glDrawElements(mode, count, type, indices);
+}
+
+void countedGenBuffers(GLsizei n, GLuint *buffers)
+{
+  glCounters.buffersCreated += n;
+  glGenBuffers(n, buffers);
+}
+
+void countedDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+  glCounters.buffersDeleted += n;
+  glDeleteBuffers(n, buffers);
+}
+
+void countedGenTextures(GLsizei n, GLuint *textures)
+{
+  glCounters.texturesCreated += n;
+  glGenTextures(n, textures);
+}
+
+void countedDeleteTextures(GLsizei n, const GLuint *textures)
+{
+  glCounters.texturesDeleted += n;
+  glDeleteTextures(n, textures);
+}
+
+void countedBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+  if (data)
+    glCounters.uploadBytes += size;
+  glBufferData(target, size, data, usage);
+}
+
+void countedBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+  glCounters.uploadBytes += size;
+  glBufferSubData(target, offset, size, data);
+}
+
+void countedTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type,
+                       const void *pixels)
+{
+  if (pixels)
+    glCounters.uploadBytes += (uint64_t)width * height * glTexelBytes(format, type);
+  glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+}
+
+void countedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+{
+  glCounters.uploadBytes += (uint64_t)width * height * glTexelBytes(format, type);
+  glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+void countedUseProgram(GLuint program)
+{
+  glCounters.stateChanges++;
+  glUseProgram(program);
+}
+
+void countedBindBuffer(GLenum target, GLuint buffer)
+{
+  glCounters.stateChanges++;
+  glBindBuffer(target, buffer);
+}
+
+void countedBindTexture(GLenum target, GLuint texture)
+{
+  glCounters.stateChanges++;
+  glBindTexture(target, texture);
+}
+
+void countedActiveTexture(GLenum unit)
+{
+  glCounters.stateChanges++;
+  glActiveTexture(unit);
+}
+
+void countedEnable(GLenum capability)
+{
+  glCounters.stateChanges++;
+  glEnable(capability);
+}
+
+void countedDisable(GLenum capability)
+{
+  glCounters.stateChanges++;
+  glDisable(capability);
+}
+
+void countedBlendFunc(GLenum source, GLenum destination)
+{
+  glCounters.stateChanges++;
+  glBlendFunc(source, destination);
+}
+
+void countedTexParameteri(GLenum target, GLenum name, GLint value)
+{
+  glCounters.stateChanges++;
+  glTexParameteri(target, name, value);
+}
+
+void countedPixelStorei(GLenum name, GLint value)
+{
+  glCounters.stateChanges++;
+  glPixelStorei(name, value);
+}
+
+void countedEnableVertexAttribArray(GLuint index)
+{
+  glCounters.stateChanges++;
+  glEnableVertexAttribArray(index);
+}
+
+void countedDisableVertexAttribArray(GLuint index)
+{
+  glCounters.stateChanges++;
+  glDisableVertexAttribArray(index);
+}
+
+void countedVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer)
+{
+  glCounters.stateChanges++;
+  glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void countedUniform1i(GLint location, GLint x)
+{
+  glCounters.uniformUpdates++;
+  glUniform1i(location, x);
+}
+
+void countedUniform1f(GLint location, GLfloat x)
+{
+  glCounters.uniformUpdates++;
+  glUniform1f(location, x);
+}
+
+void countedUniform2f(GLint location, GLfloat x, GLfloat y)
+{
+  glCounters.uniformUpdates++;
+  glUniform2f(location, x, y);
+}
+
+void countedUniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z)
+{
+  glCounters.uniformUpdates++;
+  glUniform3f(location, x, y, z);
+}
+
+void countedUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+  glCounters.uniformUpdates++;
+  glUniform4f(location, x, y, z, w);
+}
+
+void countedUniform4fv(GLint location, GLsizei count, const GLfloat *values)
+{
+  glCounters.uniformUpdates++;
+  glUniform4fv(location, count, values);
+}
+
+#ifndef NO_GL_COUNTERS
+#define glDrawArrays countedDrawArrays
+#define glDrawElements countedDrawElements
+#define glGenBuffers countedGenBuffers
+#define glDeleteBuffers countedDeleteBuffers
+#define glGenTextures countedGenTextures
+#define glDeleteTextures countedDeleteTextures
+#define glBufferData countedBufferData
+#define glBufferSubData countedBufferSubData
+#define glTexImage2D countedTexImage2D
+#define glTexSubImage2D countedTexSubImage2D
+#define glUseProgram countedUseProgram
+#define glBindBuffer countedBindBuffer
+#define glBindTexture countedBindTexture
+#define glActiveTexture countedActiveTexture
+#define glEnable countedEnable
+#define glDisable countedDisable
+#define glBlendFunc countedBlendFunc
+#define glTexParameteri countedTexParameteri
+#define glPixelStorei countedPixelStorei
+#define glEnableVertexAttribArray countedEnableVertexAttribArray
+#define glDisableVertexAttribArray countedDisableVertexAttribArray
+#define glVertexAttribPointer countedVertexAttribPointer
+#define glUniform1i countedUniform1i
+#define glUniform1f countedUniform1f
+#define glUniform2f countedUniform2f
+#define glUniform3f countedUniform3f
+#define glUniform4f countedUniform4f
+#define glUniform4fv countedUniform4fv
+#endif
+
+// The counters by name, for the CSV header and budget specs
+struct GLCounterField
+{
+  const char *name;
+  uint64_t GLCounters::*field;
+};
+
+const GLCounterField glCounterFields[] = {
+    {"draws", &GLCounters::drawCalls},
+    {"buffers_created", &GLCounters::buffersCreated},
+    {"buffers_deleted", &GLCounters::buffersDeleted},
+    {"textures_created", &GLCounters::texturesCreated},
+    {"textures_deleted", &GLCounters::texturesDeleted},
+    {"upload_bytes", &GLCounters::uploadBytes},
+    {"state_changes", &GLCounters::stateChanges},
+    {"uniforms", &GLCounters::uniformUpdates}};
+const int glCounterFieldCount = sizeof(glCounterFields) / sizeof(glCounterFields[0]);
+
+// Writes one CSV row of counters per frame (--gl-csv) and checks every frame
+// against per-frame limits (--gl-budget). The first warmupFrames frames load
+// textures and fill buffers and are only logged.
+class GLFrameLog
+{
+  FILE *csv = nullptr;
+  uint64_t limits[glCounterFieldCount]; // per glCounterFields entry
+  bool hasBudget = false;
+  int frame = 0;
+
+  public:
+    GLFrameLog()
+    {
+      for (uint64_t &limit : limits)
+        limit = UINT64_MAX;
+    }
+
+    int warmupFrames = 2;
+    int overBudgetFrames = 0;
+
+    ~GLFrameLog()
+    {
+      close();
+    }
+
+    bool openCsv(const string &path)
+    {
+      csv = fopen(path.c_str(), "w");
+      if (!csv)
+        return false;
+      fprintf(csv, "frame");
+      for (const GLCounterField &counter : glCounterFields)
+        fprintf(csv, ",%s", counter.name);
+      fprintf(csv, "\n");
+      return true;
+    }
+
+    void close()
+    {
+      if (csv)
+        fclose(csv);
+      csv = nullptr;
+    }
+
+    // "draws=20,textures_created=0,..." with the names of glCounterFields,
+    // counters left out have no limit. Fails without changing any limit on
+    // an unknown counter or a limit that is not a plain number.
+    bool parseBudget(const string &spec)
+    {
+      uint64_t parsed[glCounterFieldCount];
+      copy(limits, limits + glCounterFieldCount, parsed);
+      size_t start = 0;
+      while (start < spec.size())
+      {
+        size_t end = spec.find(',', start);
+        if (end == string::npos)
+          end = spec.size();
+        string item = spec.substr(start, end - start);
+        size_t equals = item.find('=');
+        if (equals == string::npos || equals + 1 == item.size() || !isdigit((unsigned char)item[equals + 1]))
+          return false;
+        char *numberEnd;
+        errno = 0;
+        uint64_t limit = strtoull(item.c_str() + equals + 1, &numberEnd, 10);
+        if (*numberEnd != '\0' || errno == ERANGE)
+          return false;
+        bool known = false;
+        for (int i = 0; i < glCounterFieldCount; ++i)
+        {
+          if (equals == strlen(glCounterFields[i].name) && item.compare(0, equals, glCounterFields[i].name) == 0)
+          {
+            parsed[i] = limit;
+            known = true;
+          }
+        }
+        if (!known)
+          return false;
+        start = end + 1;
+      }
+      copy(parsed, parsed + glCounterFieldCount, limits);
+      hasBudget = true;
+      return true;
+    }
+
+    bool isActive() const
+    {
+      return csv || hasBudget;
+    }
+
+    // Logs the frame that just ended, and reports every limit it broke
+    void frameDone(const GLCounters &counters)
+    {
+      frame++;
+      if (csv)
+      {
+        fprintf(csv, "%d", frame);
+        for (const GLCounterField &counter : glCounterFields)
+          fprintf(csv, ",%llu", (unsigned long long)(counters.*counter.field));
+        fprintf(csv, "\n");
+      }
+      if (!hasBudget || frame <= warmupFrames)
+        return;
+      bool over = false;
+      for (int i = 0; i < glCounterFieldCount; ++i)
+      {
+        uint64_t value = counters.*glCounterFields[i].field;
+        if (value <= limits[i])
+          continue;
+        fprintf(stderr, "GL budget: frame %d has %s %llu, over the limit of %llu\n", frame, glCounterFields[i].name, (unsigned long long)value,
+                (unsigned long long)limits[i]);
+        over = true;
+      }
+      overBudgetFrames += over;
+    }
+};
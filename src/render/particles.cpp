@@ -0,0 +1,240 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "quad_ring.cpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+// Particles are points in cell units, faded out over their last half second
+const char *particleVertexShaderSource = R"(
+    attribute float aX;
+    attribute float aY;
+    attribute float aLife;
+    attribute vec4 aColor;
+    uniform vec4 uTransform;
+    uniform float uPointSize;
+    varying vec4 vColor;
+
+    void main() {
+        vColor = vec4(aColor.rgb, aColor.a * clamp(aLife * 2.0, 0.0, 1.0));
+        gl_Position = vec4(vec2(aX, aY) * uTransform.xy + uTransform.zw, 0.0, 1.0);
+        gl_PointSize = uPointSize;
+    }
+)";
+
+const char *particleFragmentShaderSource = R"(
+  precision mediump float;
+  varying vec4 vColor;
+
+  void main() {
+    gl_FragColor = vColor;
+  }
+)";
+
+// RGBA bytes in memory order, for the normalized aColor attribute
+inline uint32_t particleColor(unsigned char r, unsigned char g, unsigned char b, unsigned char a = 255)
+{
+  return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+struct ParticleBurst
+{
+  int count;
+  float speedMin, speedMax; // cells per second
+  float lifeMin, lifeMax;   // seconds
+  uint32_t color;
+};
+
+const ParticleBurst fruitEatenBurst = {48, 2.0f, 7.0f, 0.4f, 0.9f, particleColor(255, 255, 0)};
+const ParticleBurst gameOverBurst = {600, 1.0f, 16.0f, 0.8f, 1.8f, particleColor(255, 255, 255)};
+
+// Fixed-capacity particle pool stored as structure of arrays, so integration
+// runs four particles per instruction (SSE2/NEON) and every array uploads
+// as is into its own range of one vertex buffer. Live particles are kept
+// packed at the front: dead ones are replaced by the last live one.
+class ParticleSystem
+{
+  size_t capacity = 0;
+  size_t count = 0;
+  vector<float> posX, posY, velX, velY, life;
+  vector<uint32_t> colors;
+  uint32_t seed = 0x9E3779B9u;
+
+  GLuint vbo = 0;
+  GLint xLoc = -1, yLoc = -1, lifeLoc = -1, colorLoc = -1;
+
+  // xorshift, effects do not need a better generator
+  float random(float low, float high)
+  {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return low + (high - low) * (seed >> 8) * (1.0f / 16777216.0f);
+  }
+
+  void compact()
+  {
+    for (size_t i = 0; i < count;)
+    {
+      if (life[i] > 0.0f)
+      {
+        ++i;
+        continue;
+      }
+      --count;
+      posX[i] = posX[count];
+      posY[i] = posY[count];
+      velX[i] = velX[count];
+      velY[i] = velY[count];
+      life[i] = life[count];
+      colors[i] = colors[count];
+    }
+  }
+
+  public:
+    float drag = 2.5f; // velocity lost per second, as a fraction
+
+    void init(size_t particleCapacity)
+    {
+      capacity = particleCapacity;
+      count = 0;
+      posX.assign(capacity, 0.0f);
+      posY.assign(capacity, 0.0f);
+      velX.assign(capacity, 0.0f);
+      velY.assign(capacity, 0.0f);
+      life.assign(capacity, 0.0f);
+      colors.assign(capacity, 0);
+    }
+
+    size_t size() const
+    {
+      return count;
+    }
+
+    // Emits a burst from the centre of a cell. A full pool drops the rest.
+    void spawn(float x, float y, const ParticleBurst &burst)
+    {
+      for (int i = 0; i < burst.count && count < capacity; ++i, ++count)
+      {
+        float angle = random(0.0f, 6.2831853f);
+        float speed = random(burst.speedMin, burst.speedMax);
+        posX[count] = x;
+        posY[count] = y;
+        velX[count] = cosf(angle) * speed;
+        velY[count] = sinf(angle) * speed;
+        life[count] = random(burst.lifeMin, burst.lifeMax);
+        colors[count] = burst.color;
+      }
+    }
+
+    void clear()
+    {
+      count = 0;
+    }
+
+    // Semi-implicit Euler: damp the velocity, move, age. Scalar code only
+    // handles the last few particles that do not fill a vector.
+    void update(float dt)
+    {
+      float damping = max(1.0f - drag * dt, 0.0f);
+      size_t i = 0;
+#if defined(__SSE2__)
+      __m128 step = _mm_set1_ps(dt);
+      __m128 damp = _mm_set1_ps(damping);
+      for (; i + 4 <= count; i += 4)
+      {
+        __m128 vx = _mm_mul_ps(_mm_loadu_ps(&velX[i]), damp);
+        __m128 vy = _mm_mul_ps(_mm_loadu_ps(&velY[i]), damp);
+        _mm_storeu_ps(&velX[i], vx);
+        _mm_storeu_ps(&velY[i], vy);
+        _mm_storeu_ps(&posX[i], _mm_add_ps(_mm_loadu_ps(&posX[i]), _mm_mul_ps(vx, step)));
+        _mm_storeu_ps(&posY[i], _mm_add_ps(_mm_loadu_ps(&posY[i]), _mm_mul_ps(vy, step)));
+        _mm_storeu_ps(&life[i], _mm_sub_ps(_mm_loadu_ps(&life[i]), step));
+      }
+#elif defined(__ARM_NEON)
+      float32x4_t step = vdupq_n_f32(dt);
+      float32x4_t damp = vdupq_n_f32(damping);
+      for (; i + 4 <= count; i += 4)
+      {
+        float32x4_t vx = vmulq_f32(vld1q_f32(&velX[i]), damp);
+        float32x4_t vy = vmulq_f32(vld1q_f32(&velY[i]), damp);
+        vst1q_f32(&velX[i], vx);
+        vst1q_f32(&velY[i], vy);
+        vst1q_f32(&posX[i], vmlaq_f32(vld1q_f32(&posX[i]), vx, step));
+        vst1q_f32(&posY[i], vmlaq_f32(vld1q_f32(&posY[i]), vy, step));
+        vst1q_f32(&life[i], vsubq_f32(vld1q_f32(&life[i]), step));
+      }
+#endif
+      for (; i < count; ++i)
+      {
+        velX[i] *= damping;
+        velY[i] *= damping;
+        posX[i] += velX[i] * dt;
+        posY[i] += velY[i] * dt;
+        life[i] -= dt;
+      }
+      compact();
+    }
+
+    // Looks up the attributes of a program built from the particle shaders
+    // and creates the vertex buffer, call after init()
+    void bind(GLuint program)
+    {
+      xLoc = glGetAttribLocation(program, "aX");
+      yLoc = glGetAttribLocation(program, "aY");
+      lifeLoc = glGetAttribLocation(program, "aLife");
+      colorLoc = glGetAttribLocation(program, "aColor");
+      // Sized for the whole pool up front, so no frame ever creates it
+      if (!vbo)
+        glGenBuffers(1, &vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glBufferData(GL_ARRAY_BUFFER, capacity * 4 * sizeof(float), nullptr, GL_STREAM_DRAW);
+    }
+
+    // Uploads the live particles, one glBufferSubData per array
+    void upload()
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      if (count == 0)
+        return;
+      size_t bytes = count * sizeof(float);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, posX.data());
+      glBufferSubData(GL_ARRAY_BUFFER, capacity * sizeof(float), bytes, posY.data());
+      glBufferSubData(GL_ARRAY_BUFFER, capacity * 2 * sizeof(float), bytes, life.data());
+      glBufferSubData(GL_ARRAY_BUFFER, capacity * 3 * sizeof(float), bytes, colors.data());
+      uploadStats.frameBytes += bytes * 4;
+      uploadStats.totalBytes += bytes * 4;
+    }
+
+    // Every live particle in one GL_POINTS draw, with the particle program
+    // in use and its uTransform set
+    void draw()
+    {
+      if (count == 0)
+        return;
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glEnableVertexAttribArray(xLoc);
+      glEnableVertexAttribArray(yLoc);
+      glEnableVertexAttribArray(lifeLoc);
+      glEnableVertexAttribArray(colorLoc);
+      glVertexAttribPointer(xLoc, 1, GL_FLOAT, GL_FALSE, 0, (void *)0);
+      glVertexAttribPointer(yLoc, 1, GL_FLOAT, GL_FALSE, 0, (void *)(capacity * sizeof(float)));
+      glVertexAttribPointer(lifeLoc, 1, GL_FLOAT, GL_FALSE, 0, (void *)(capacity * 2 * sizeof(float)));
+      glVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (void *)(capacity * 3 * sizeof(float)));
+      glDrawArrays(GL_POINTS, 0, count);
+      glDisableVertexAttribArray(xLoc);
+      glDisableVertexAttribArray(yLoc);
+      glDisableVertexAttribArray(lifeLoc);
+      glDisableVertexAttribArray(colorLoc);
+    }
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "quad_ring.cpp"
+#include "gl_counters.cpp"
+#include "text_mesh.cpp"
+
+using namespace std;
+
+// What one frame cost, from the end of the previous frame's overlay to the
+// start of this one's
+struct FrameSample
+{
+  GLCounters gl;
+  uint64_t heapAllocations;
+  uint64_t simTicks; // total so far
+};
+
+// Performance overlay: frame rate, a frame time graph, simulation ticks,
+// the GL counters and heap allocations. Frames are sampled
+// every time, but the text and graph are formatted and uploaded only 4 times
+// a second into one buffer. Drawing then takes 3 draw calls and never
+// allocates. The caller samples before the overlay draws, so the overlay's
+// own work stays out of the numbers.
+class PerfHud
+{
+  static const int graphFrames = 100;
+  static const int lineCount = 7;
+
+  const chrono::steady_clock::duration refreshInterval = chrono::milliseconds(250);
+  const float graphMaxMs = 50.0f;
+  const float left = 0.02f, top = 0.98f, textScale = 0.04f;
+  const float graphWidth = 0.9f, graphHeight = 0.15f;
+
+  float frameMs[graphFrames] = {};
+  int nextFrame = 0;
+  chrono::steady_clock::time_point lastFrame, windowStart;
+  bool started = false;
+
+  // Sums over the current window
+  int frames = 0;
+  double frameMsSum = 0.0;
+  GLCounters gl;
+  uint64_t heapAllocations = 0, windowStartTicks = 0;
+
+  TextMesh lines[lineCount];
+  vector<Quad> quads; // panel, graph bars, then glyphs
+  int barCount = 0;
+  GLuint vbo = 0;
+  bool uploaded = false;
+
+  void rebuild(chrono::steady_clock::time_point now, uint64_t simTicks)
+  {
+    double seconds = chrono::duration<double>(now - windowStart).count();
+    char text[lineCount][40];
+    double perFrame = frames ? 1.0 / frames : 0.0;
+    snprintf(text[0], sizeof(text[0]), "FPS %.1f  %.1f MS", frames / seconds, frameMsSum * perFrame);
+    snprintf(text[1], sizeof(text[1]), "SIM %.1f TICKS/S", (simTicks - windowStartTicks) / seconds);
+    snprintf(text[2], sizeof(text[2]), "DRAWS %.1f STATE %.1f", gl.drawCalls * perFrame, gl.stateChanges * perFrame);
+    snprintf(text[3], sizeof(text[3]), "UNIFORMS %.1f", gl.uniformUpdates * perFrame);
+    snprintf(text[4], sizeof(text[4]), "UPLOAD %.1f KB/FRAME", gl.uploadBytes * perFrame / 1024.0);
+    snprintf(text[5], sizeof(text[5]), "GL BUF +%d-%d TEX +%d-%d", (int)gl.buffersCreated, (int)gl.buffersDeleted, (int)gl.texturesCreated,
+             (int)gl.texturesDeleted);
+    snprintf(text[6], sizeof(text[6]), "HEAP %.1f ALLOCS/FRAME", heapAllocations * perFrame);
+
+    float bottom = top - lineCount * textScale * 1.25f - graphHeight - 0.03f;
+    quads.clear();
+    quads.push_back(makeQuad(left - 0.01f, bottom - 0.01f, graphWidth + 0.02f, top - bottom + 0.02f));
+
+    // Oldest frame on the left
+    float barWidth = graphWidth / graphFrames;
+    for (int i = 0; i < graphFrames; ++i)
+    {
+      float ms = min(frameMs[(nextFrame + i) % graphFrames], graphMaxMs);
+      if (ms > 0.0f)
+        quads.push_back(makeQuad(left + i * barWidth, bottom, barWidth * 0.8f, graphHeight * ms / graphMaxMs));
+    }
+    barCount = quads.size() - 1;
+
+    for (int i = 0; i < lineCount; ++i)
+    {
+      lines[i].build(text[i], left, top - (i + 1) * textScale * 1.25f, textScale);
+      quads.insert(quads.end(), lines[i].quads().begin(), lines[i].quads().end());
+    }
+    uploaded = false;
+
+    windowStart = now;
+    windowStartTicks = simTicks;
+    frames = 0;
+    frameMsSum = 0.0;
+    gl = GLCounters();
+    heapAllocations = 0;
+  }
+
+  void drawRange(int first, int count)
+  {
+    glDrawArrays(GL_TRIANGLES, first * 6, count * 6);
+  }
+
+  public:
+    bool visible = false;
+
+    // Counts a frame that ended now, rebuilds the overlay when due
+    void frame(const FrameSample &sample)
+    {
+      auto now = chrono::steady_clock::now();
+      if (!started)
+      {
+        started = true;
+        lastFrame = windowStart = now;
+        windowStartTicks = sample.simTicks;
+        return;
+      }
+      float ms = chrono::duration<float, milli>(now - lastFrame).count();
+      lastFrame = now;
+      frameMs[nextFrame] = ms;
+      nextFrame = (nextFrame + 1) % graphFrames;
+      frames++;
+      frameMsSum += ms;
+      for (const GLCounterField &counter : glCounterFields)
+        gl.*counter.field += sample.gl.*counter.field;
+      heapAllocations += sample.heapAllocations;
+      if (now - windowStart >= refreshInterval)
+        rebuild(now, sample.simTicks);
+    }
+
+    // Frame times around a hidden stretch would be meaningless
+    void restart()
+    {
+      started = false;
+    }
+
+    // With the quad program bound and an identity transform; the font comes
+    // from the atlas
+    void draw(GLint posLoc, GLint texLoc, GLint colorLoc, GLint useTextureLoc, GLuint atlasTexture)
+    {
+      if (quads.empty())
+        return;
+      if (!vbo)
+        glGenBuffers(1, &vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      if (!uploaded)
+      {
+        glBufferData(GL_ARRAY_BUFFER, quads.size() * sizeof(Quad), quads.data(), GL_DYNAMIC_DRAW);
+        uploaded = true;
+      }
+
+      glEnableVertexAttribArray(posLoc);
+      glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)0);
+      glEnableVertexAttribArray(texLoc);
+      glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)(2 * sizeof(float)));
+
+      glUniform1i(useTextureLoc, 0);
+      glUniform3f(colorLoc, 0.1f, 0.1f, 0.15f);
+      drawRange(0, 1);
+      glUniform3f(colorLoc, 0.3f, 0.9f, 0.4f);
+      drawRange(1, barCount);
+      glBindTexture(GL_TEXTURE_2D, atlasTexture);
+      glUniform1i(useTextureLoc, 1);
+      glUniform3f(colorLoc, 1.0f, 1.0f, 1.0f);
+      drawRange(1 + barCount, quads.size() - 1 - barCount);
+      glUniform1i(useTextureLoc, 0);
+
+      glDisableVertexAttribArray(posLoc);
+      glDisableVertexAttribArray(texLoc);
+    }
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <vector>
+
+using namespace std;
+
+// Bytes handed to the driver through buffer uploads, reset once per frame
+struct UploadStats
+{
+  size_t frameBytes = 0;
+  size_t totalBytes = 0;
+  int fullUploads = 0;
+};
+UploadStats uploadStats;
+
+struct QuadVertex
+{
+  float x, y, u, v;
+};
+
+// Two triangles, GLES2 has no GL_QUADS
+struct Quad
+{
+  QuadVertex vertices[6];
+};
+
+Quad makeQuad(float x, float y, float width, float height, float u1 = 0.0f, float v1 = 0.0f, float u2 = 1.0f, float v2 = 1.0f)
+{
+  Quad quad = {{{x, y, u1, v1},
+                {x + width, y, u2, v1},
+                {x + width, y + height, u2, v2},
+                {x, y, u1, v1},
+                {x + width, y + height, u2, v2},
+                {x, y + height, u1, v2}}};
+  return quad;
+}
+
+// Fixed-capacity ring of quads living in one GL buffer. Index 0 is the
+// front (the snake's head); pushing a head or dropping a tail only touches
+// one slot, so a tick costs a single glBufferSubData instead of a re-upload.
+class QuadRing
+{
+  GLuint vbo = 0;
+  int capacity = 0;
+  int first = 0;
+  int count = 0;
+
+  int slot(int index) const
+  {
+    return (first + index) % capacity;
+  }
+
+  void uploadSlot(int slotIndex, const Quad &quad)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, slotIndex * sizeof(Quad), sizeof(Quad), &quad);
+    uploadStats.frameBytes += sizeof(Quad);
+    uploadStats.totalBytes += sizeof(Quad);
+  }
+
+  void drawRange(int firstSlot, int slots)
+  {
+    glDrawArrays(GL_TRIANGLES, firstSlot * 6, slots * 6);
+  }
+
+  public:
+    void init(int quadCapacity)
+    {
+      capacity = quadCapacity;
+      first = 0;
+      count = 0;
+      if (!vbo)
+        glGenBuffers(1, &vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Quad), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    int size() const
+    {
+      return count;
+    }
+
+    // Full re-upload, only meant for resets
+    void upload(const vector<Quad> &quads)
+    {
+      if ((int)quads.size() > capacity)
+        init(quads.size() * 2);
+      first = 0;
+      count = quads.size();
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Quad), quads.data());
+      uploadStats.frameBytes += count * sizeof(Quad);
+      uploadStats.totalBytes += count * sizeof(Quad);
+      uploadStats.fullUploads++;
+    }
+
+    // Returns false when the ring is full and the caller has to re-upload
+    bool pushFront(const Quad &quad)
+    {
+      if (count == capacity)
+        return false;
+      first = (first + capacity - 1) % capacity;
+      count++;
+      uploadSlot(first, quad);
+      return true;
+    }
+
+    bool pushBack(const Quad &quad)
+    {
+      if (count == capacity)
+        return false;
+      count++;
+      uploadSlot(slot(count - 1), quad);
+      return true;
+    }
+
+    void popBack()
+    {
+      if (count > 0)
+        count--;
+    }
+
+    void replace(int index, const Quad &quad)
+    {
+      uploadSlot(slot(index), quad);
+    }
+
+    void draw(GLint posLoc, GLint texLoc)
+    {
+      if (count == 0)
+        return;
+
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glEnableVertexAttribArray(posLoc);
+      glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)0);
+      if (texLoc >= 0)
+      {
+        glEnableVertexAttribArray(texLoc);
+        glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)(2 * sizeof(float)));
+      }
+
+      // The live range wraps past the end of the buffer at most once
+      int tailRoom = capacity - first;
+      if (count <= tailRoom)
+      {
+        drawRange(first, count);
+      }
+      else
+      {
+        drawRange(first, tailRoom);
+        drawRange(0, count - tailRoom);
+      }
+
+      glDisableVertexAttribArray(posLoc);
+      if (texLoc >= 0)
+        glDisableVertexAttribArray(texLoc);
+    }
+};
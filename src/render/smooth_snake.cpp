@@ -0,0 +1,126 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "quad_ring.cpp"
+#include "chunked_board.cpp"
+#include "snake_sprites.cpp"
+
+using namespace std;
+
+// Where a segment is drawn alpha of the way from its cell before the last
+// tick to its cell now. A move across the wrap seam goes one cell over the
+// edge instead of sliding back across the board; anything further apart
+// (a reset) snaps.
+void interpolateSegment(const SnakeGame &game, const Cell &from, const Cell &to, float alpha, float &x, float &y)
+{
+  Cell step = neighbourOffset(from, to);
+  if ((from.x + step.x + game.columns) % game.columns != to.x || (from.y + step.y + game.rows) % game.rows != to.y)
+  {
+    x = to.x;
+    y = to.y;
+    return;
+  }
+  x = from.x + step.x * alpha;
+  y = from.y + step.y * alpha;
+}
+
+// The snake as free-moving quads for interpolated rendering. Rebuilt every
+// frame from the previous and current tick, so the board underneath only
+// draws the fruit. Segment i moves from previousBody[i] to snakeBody[i];
+// one grown by eating follows the old tail.
+class SmoothSnake
+{
+  GLuint vbo = 0;
+  vector<Quad> quads;
+
+  // Adds a cell-sized quad at (x, y), split where it hangs over an edge so
+  // the part beyond the seam shows up on the opposite side of the board
+  void addWrapped(const SnakeGame &game, float x, float y, const AtlasRect &rect)
+  {
+    float xs[2] = {x, x < 0.0f ? x + game.columns : x - game.columns};
+    float ys[2] = {y, y < 0.0f ? y + game.rows : y - game.rows};
+    int copiesX = x < 0.0f || x + 1.0f > game.columns ? 2 : 1;
+    int copiesY = y < 0.0f || y + 1.0f > game.rows ? 2 : 1;
+    for (int j = 0; j < copiesY; ++j)
+    {
+      for (int i = 0; i < copiesX; ++i)
+      {
+        float left = max(xs[i], 0.0f), right = min(xs[i] + 1.0f, (float)game.columns);
+        float bottom = max(ys[j], 0.0f), top = min(ys[j] + 1.0f, (float)game.rows);
+        if (left >= right || bottom >= top)
+          continue;
+        // Atlas v runs top down
+        float u1 = rect.u1 + (rect.u2 - rect.u1) * (left - xs[i]);
+        float u2 = rect.u1 + (rect.u2 - rect.u1) * (right - xs[i]);
+        float v1 = rect.v2 + (rect.v1 - rect.v2) * (bottom - ys[j]);
+        float v2 = rect.v2 + (rect.v1 - rect.v2) * (top - ys[j]);
+        quads.push_back(makeQuad(left, bottom, right - left, top - bottom, u1, v1, u2, v2));
+      }
+    }
+  }
+
+  // Segments more than a cell outside the view in every board copy are skipped
+  bool isVisible(const SnakeGame &game, const Camera &camera, float x, float y) const
+  {
+    if (camera.showsWholeBoard(game.columns, game.rows))
+      return true;
+    float dx = fmod(x + 0.5f - camera.x, (float)game.columns);
+    float dy = fmod(y + 0.5f - camera.y, (float)game.rows);
+    dx = min(fabs(dx), game.columns - fabs(dx));
+    dy = min(fabs(dy), game.rows - fabs(dy));
+    return dx <= camera.viewColumns / 2.0f + 1.0f && dy <= camera.viewRows / 2.0f + 1.0f;
+  }
+
+  public:
+    // sprites picks each segment's tile in the atlas, empty for flat quads
+    void build(const SnakeGame &game, const vector<Cell> &previousBody, const vector<unsigned char> &sprites, float alpha,
+               const Camera &camera)
+    {
+      static const AtlasRect flat = {0.0f, 0.0f, 1.0f, 1.0f};
+      quads.clear();
+      for (size_t i = 0; i < game.snakeBody.size(); ++i)
+      {
+        float x, y;
+        const Cell &from = previousBody.empty() ? game.snakeBody[i] : previousBody[min(i, previousBody.size() - 1)];
+        interpolateSegment(game, from, game.snakeBody[i], alpha, x, y);
+        if (isVisible(game, camera, x, y))
+          addWrapped(game, x, y, sprites.empty() ? flat : snakeRects[sprites[i]]);
+      }
+
+      if (!vbo)
+        glGenBuffers(1, &vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glBufferData(GL_ARRAY_BUFFER, quads.size() * sizeof(Quad), quads.data(), GL_STREAM_DRAW);
+      uploadStats.frameBytes += quads.size() * sizeof(Quad);
+      uploadStats.totalBytes += quads.size() * sizeof(Quad);
+    }
+
+    // Draws into every board copy the camera sees; texLoc < 0 for flat quads
+    void draw(const SnakeGame &game, const Camera &camera, GLint posLoc, GLint texLoc, GLint transformLoc)
+    {
+      if (quads.empty())
+        return;
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glEnableVertexAttribArray(posLoc);
+      glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)0);
+      if (texLoc >= 0)
+      {
+        glEnableVertexAttribArray(texLoc);
+        glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)(2 * sizeof(float)));
+      }
+      float transform[4];
+      for (const Cell &copy : visibleBoardCopies(camera, game.columns, game.rows))
+      {
+        camera.transform(copy.x, copy.y, transform);
+        glUniform4fv(transformLoc, 1, transform);
+        glDrawArrays(GL_TRIANGLES, 0, quads.size() * 6);
+      }
+      glDisableVertexAttribArray(posLoc);
+      if (texLoc >= 0)
+        glDisableVertexAttribArray(texLoc);
+      glUniform4f(transformLoc, 1.0f, 1.0f, 0.0f, 0.0f);
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include "atlas_rects.h"
+#include "../simulation.cpp"
+
+using namespace std;
+
+// snake-graphics tiles as atlas indices, row * snakeColumns + column
+const int fruitSprite = 15;
+
+// Offset from a to its neighbour b, -1, 0 or 1 per axis across the seam
+Cell neighbourOffset(const Cell &a, const Cell &b)
+{
+  Cell offset = {b.x - a.x, b.y - a.y};
+  if (offset.x > 1)
+    offset.x = -1;
+  else if (offset.x < -1)
+    offset.x = 1;
+  if (offset.y > 1)
+    offset.y = -1;
+  else if (offset.y < -1)
+    offset.y = 1;
+  return offset;
+}
+
+// Picks the snake-graphics tile for a segment from its neighbours, the same
+// choice the web build makes. Segments stacked on one cell after eating are
+// skipped over, so the last distinct cell still gets the tail.
+int snakeSpriteAt(const SnakeGame &game, size_t index)
+{
+  const vector<Cell> &body = game.snakeBody;
+  const Cell &cell = body[index];
+  size_t prevIndex = index, nextIndex = index;
+  while (prevIndex > 0 && body[prevIndex] == cell)
+    prevIndex--;
+  while (nextIndex + 1 < body.size() && body[nextIndex] == cell)
+    nextIndex++;
+  bool hasPrev = index > 0 && !(body[prevIndex] == cell);
+  bool hasNext = !(body[nextIndex] == cell);
+  Cell p = hasPrev ? neighbourOffset(cell, body[prevIndex]) : Cell{0, 0};
+  Cell n = hasNext ? neighbourOffset(cell, body[nextIndex]) : Cell{0, 0};
+
+  if (index == 0)
+  {
+    if (!hasNext)
+      return game.snakeDirection == RIGHT ? 4 : game.snakeDirection == DOWN ? 9 : game.snakeDirection == LEFT ? 8 : 3;
+    if (n.y < 0)
+      return 3; // Up
+    if (n.x < 0)
+      return 4; // Right
+    if (n.y > 0)
+      return 9; // Down
+    return 8;   // Left
+  }
+
+  if (!hasNext)
+  {
+    if (p.y > 0)
+      return 13; // Up
+    if (p.x > 0)
+      return 14; // Right
+    if (p.y < 0)
+      return 19; // Down
+    return 18;   // Left
+  }
+
+  if ((p.x < 0 && n.x > 0) || (n.x < 0 && p.x > 0))
+    return 1; // Horizontal
+  if ((p.x < 0 && n.y > 0) || (n.x < 0 && p.y > 0))
+    return 12; // Left-up
+  if ((p.y < 0 && n.y > 0) || (n.y < 0 && p.y > 0))
+    return 7; // Vertical
+  if ((p.y < 0 && n.x < 0) || (n.y < 0 && p.x < 0))
+    return 2; // Down-left
+  if ((p.x > 0 && n.y < 0) || (n.x > 0 && p.y < 0))
+    return 0; // Right-down
+  return 5;   // Up-right
+}
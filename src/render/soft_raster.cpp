@@ -0,0 +1,475 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "../simulation.cpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+// Packs a colour in RGBA byte order for a little-endian uint32_t
+inline uint32_t rgba(unsigned char r, unsigned char g, unsigned char b, unsigned char a = 255)
+{
+  return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+// Colours of src/game.cpp's render()
+const uint32_t softBackgroundColor = rgba(0, 0, 0);
+const uint32_t softSnakeColor = rgba(255, 255, 255);
+const uint32_t softFruitColor = rgba(255, 255, 0);
+const uint32_t softGameOverColor = rgba(128, 255, 0);
+
+// Tiny baked 5x7 font, one byte per row with bit 4 as the leftmost pixel.
+// Lowercase is drawn as uppercase, anything missing as a blank.
+struct TinyGlyph
+{
+  char c;
+  unsigned char rows[7];
+};
+
+const TinyGlyph tinyFontGlyphs[] = {
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+    {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+    {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+    {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {'A', {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+    {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+    {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+    {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+    {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+    {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+    {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+    {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {'!', {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}},
+    {'\'', {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}},
+    {'"', {0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00}},
+};
+
+const int tinyGlyphWidth = 5;
+const int tinyGlyphHeight = 7;
+const int tinyGlyphAdvance = 6;
+
+// Fills count pixels with one colour, four (SSE2/NEON) at a time. Long
+// runs on x86 use rep stos, which writes whole cache lines without reading
+// them first and beats the SSE2 loop by about 15% on a full frame.
+inline void fillRow(uint32_t *dst, int count, uint32_t color)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  if (count >= 4096)
+  {
+    size_t words = count;
+    asm volatile("rep stosl" : "+D"(dst), "+c"(words) : "a"(color) : "memory");
+    return;
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i value = _mm_set1_epi32((int)color);
+  for (; count >= 16; count -= 16, dst += 16)
+  {
+    _mm_storeu_si128((__m128i *)dst, value);
+    _mm_storeu_si128((__m128i *)(dst + 4), value);
+    _mm_storeu_si128((__m128i *)(dst + 8), value);
+    _mm_storeu_si128((__m128i *)(dst + 12), value);
+  }
+  for (; count >= 4; count -= 4, dst += 4)
+    _mm_storeu_si128((__m128i *)dst, value);
+#elif defined(__ARM_NEON)
+  uint32x4_t value = vdupq_n_u32(color);
+  for (; count >= 4; count -= 4, dst += 4)
+    vst1q_u32(dst, value);
+#endif
+  while (count-- > 0)
+    *dst++ = color;
+}
+
+struct SoftRect
+{
+  int x0, y0, x1, y1; // half open, rows top to bottom
+
+  bool empty() const
+  {
+    return x0 >= x1 || y0 >= y1;
+  }
+
+  SoftRect clip(const SoftRect &other) const
+  {
+    return {max(x0, other.x0), max(y0, other.y0), min(x1, other.x1), min(y1, other.y1)};
+  }
+};
+
+struct SoftText
+{
+  string text;
+  int x, y, scale;
+  uint32_t color;
+
+  bool operator==(const SoftText &other) const
+  {
+    return text == other.text && x == other.x && y == other.y && scale == other.scale && color == other.color;
+  }
+
+  SoftRect bounds() const
+  {
+    return {x, y, x + (int)text.size() * tinyGlyphAdvance * scale, y + tinyGlyphHeight * scale};
+  }
+};
+
+// CPU renderer for the board into an RGBA framebuffer. The screen is split
+// into tiles and only tiles touched by a changed cell or changed text are
+// redrawn, so a typical tick costs a handful of tiles rather than the whole
+// frame. Full redraws are split into horizontal bands across threads, which
+// are started once with the renderer and woken for every banded frame.
+class SoftRenderer
+{
+  enum CellState : unsigned char
+  {
+    CELL_EMPTY,
+    CELL_SNAKE,
+    CELL_FRUIT
+  };
+
+  int width, height;
+  int threads;
+  int tileCols, tileRows;
+  int columns = 0, rows = 0;
+  vector<uint32_t> framebuffer;
+  vector<unsigned char> cells, prevCells;
+  vector<unsigned char> dirty;
+  vector<SoftText> texts, prevTexts;
+  bool prevGameOver = false;
+  bool hasFrame = false;
+  unsigned char glyphTable[128][tinyGlyphHeight] = {};
+
+  // Band workers, one per thread after the first, which renders band 0
+  vector<thread> workers;
+  mutex workMutex;
+  condition_variable workReady, workDone;
+  uint64_t workGeneration = 0; // bumped for every banded frame
+  int pendingBands = 0;
+  bool stopping = false;
+
+  SoftRect cellRect(int cx, int cy) const
+  {
+    // Cell rows count up from the bottom like the GL renderers
+    return {cx * width / columns, height - (cy + 1) * height / rows, (cx + 1) * width / columns, height - cy * height / rows};
+  }
+
+  SoftRect tileRect(int tx, int ty) const
+  {
+    return {tx * tileSize, ty * tileSize, min((tx + 1) * tileSize, width), min((ty + 1) * tileSize, height)};
+  }
+
+  void markRect(const SoftRect &rect)
+  {
+    SoftRect r = rect.clip({0, 0, width, height});
+    if (r.empty())
+      return;
+    for (int ty = r.y0 / tileSize; ty <= (r.y1 - 1) / tileSize; ++ty)
+    {
+      for (int tx = r.x0 / tileSize; tx <= (r.x1 - 1) / tileSize; ++tx)
+        dirty[ty * tileCols + tx] = 1;
+    }
+  }
+
+  void markAll()
+  {
+    fill(dirty.begin(), dirty.end(), 1);
+  }
+
+  void fillRect(const SoftRect &rect, uint32_t color)
+  {
+    // Full-width rows are contiguous, one long fill streams best
+    if (rect.x0 == 0 && rect.x1 == width)
+    {
+      fillRow(&framebuffer[(size_t)rect.y0 * width], (rect.y1 - rect.y0) * width, color);
+      return;
+    }
+    for (int y = rect.y0; y < rect.y1; ++y)
+      fillRow(&framebuffer[(size_t)y * width + rect.x0], rect.x1 - rect.x0, color);
+  }
+
+  void drawText(const SoftText &text, const SoftRect &clip)
+  {
+    if (text.bounds().clip(clip).empty())
+      return;
+    int penX = text.x;
+    for (char c : text.text)
+    {
+      const unsigned char *glyph = glyphTable[toupper((unsigned char)c) & 127];
+      for (int row = 0; row < tinyGlyphHeight; ++row)
+      {
+        for (int col = 0; col < tinyGlyphWidth; ++col)
+        {
+          if (!(glyph[row] & (0x10 >> col)))
+            continue;
+          int px = penX + col * text.scale;
+          int py = text.y + row * text.scale;
+          SoftRect dot = SoftRect{px, py, px + text.scale, py + text.scale}.clip(clip);
+          if (!dot.empty())
+            fillRect(dot, text.color);
+        }
+      }
+      penX += tinyGlyphAdvance * text.scale;
+    }
+  }
+
+  // Redraws area, a tile or a strip of whole tile rows
+  void renderArea(const SoftRect &tile)
+  {
+    fillRect(tile, softBackgroundColor);
+
+    // Cells overlapping the tile, padded by one to absorb rounding
+    int cx0 = max(0, tile.x0 * columns / width - 1);
+    int cx1 = min(columns - 1, (tile.x1 - 1) * columns / width + 1);
+    int cy0 = max(0, (height - tile.y1) * rows / height - 1);
+    int cy1 = min(rows - 1, (height - tile.y0) * rows / height + 1);
+    for (int cy = cy0; cy <= cy1; ++cy)
+    {
+      for (int cx = cx0; cx <= cx1; ++cx)
+      {
+        unsigned char state = cells[cy * columns + cx];
+        if (state == CELL_EMPTY)
+          continue;
+        SoftRect rect = cellRect(cx, cy).clip(tile);
+        if (!rect.empty())
+          fillRect(rect, state == CELL_SNAKE ? softSnakeColor : softFruitColor);
+      }
+    }
+
+    for (const auto &text : texts)
+      drawText(text, tile);
+  }
+
+  // Runs of fully dirty tile rows are drawn as one strip, which saves the
+  // per-tile overhead on full redraws
+  void renderBand(int tyBegin, int tyEnd)
+  {
+    int stripBegin = tyBegin;
+    for (int ty = tyBegin; ty <= tyEnd; ++ty)
+    {
+      bool wholeRow = ty < tyEnd && count(&dirty[ty * tileCols], &dirty[(ty + 1) * tileCols], 1) == tileCols;
+      if (wholeRow)
+        continue;
+      if (stripBegin < ty)
+        renderArea({0, tileRect(0, stripBegin).y0, width, tileRect(0, ty - 1).y1});
+      stripBegin = ty + 1;
+      if (ty == tyEnd)
+        break;
+      for (int tx = 0; tx < tileCols; ++tx)
+      {
+        if (dirty[ty * tileCols + tx])
+          renderArea(tileRect(tx, ty));
+      }
+    }
+  }
+
+  int bandRows() const
+  {
+    return (tileRows + threads - 1) / threads;
+  }
+
+  void workerLoop(int band)
+  {
+    uint64_t seen = 0;
+    while (true)
+    {
+      {
+        unique_lock<mutex> lock(workMutex);
+        workReady.wait(lock, [&] { return stopping || workGeneration != seen; });
+        if (stopping)
+          return;
+        seen = workGeneration;
+      }
+      renderBand(min(tileRows, band * bandRows()), min(tileRows, (band + 1) * bandRows()));
+      lock_guard<mutex> lock(workMutex);
+      if (--pendingBands == 0)
+        workDone.notify_one();
+    }
+  }
+
+  // The mutex hands the frame's cells and dirty tiles to the workers and
+  // their pixels back
+  void renderBanded()
+  {
+    {
+      lock_guard<mutex> lock(workMutex);
+      workGeneration++;
+      pendingBands = (int)workers.size();
+    }
+    workReady.notify_all();
+    renderBand(0, min(tileRows, bandRows()));
+    unique_lock<mutex> lock(workMutex);
+    workDone.wait(lock, [&] { return pendingBands == 0; });
+  }
+
+  void buildTexts(const SnakeGame &game)
+  {
+    texts.clear();
+    int scale = max(1, height / 600);
+    string score = "Score: " + to_string(game.playerScore);
+    if (game.isGameOver)
+    {
+      const string lines[3] = {"Game Over!", score, "Press 'Space' to restart"};
+      const float ndcY[3] = {0.2f, 0.1f, 0.0f};
+      for (int i = 0; i < 3; ++i)
+      {
+        int textWidth = (int)lines[i].size() * tinyGlyphAdvance * scale - scale;
+        int baseline = (int)((1.0f - ndcY[i]) / 2.0f * height);
+        texts.push_back({lines[i], (width - textWidth) / 2, baseline - tinyGlyphHeight * scale, scale, softGameOverColor});
+      }
+    }
+    else
+    {
+      int baseline = (int)((1.0f - 0.9f) / 2.0f * height);
+      texts.push_back({score, (int)(0.05f * width), baseline - tinyGlyphHeight * scale, scale, softSnakeColor});
+    }
+  }
+
+  public:
+    static const int tileSize = 64;
+
+    // Tiles redrawn by the last render(), for stats
+    int lastDirtyTiles = 0;
+    // Redraw everything every frame, to compare against dirty tracking
+    bool alwaysFull = false;
+
+    SoftRenderer(int width, int height, int threads = 1)
+        : width(width), height(height), threads(max(1, threads)),
+          tileCols((width + tileSize - 1) / tileSize), tileRows((height + tileSize - 1) / tileSize),
+          framebuffer((size_t)width * height, softBackgroundColor), dirty(tileCols * tileRows, 1)
+    {
+      for (const auto &glyph : tinyFontGlyphs)
+      {
+        for (int row = 0; row < tinyGlyphHeight; ++row)
+          glyphTable[(int)glyph.c][row] = glyph.rows[row];
+      }
+      for (int band = 1; band < this->threads; ++band)
+        workers.emplace_back(&SoftRenderer::workerLoop, this, band);
+    }
+
+    ~SoftRenderer()
+    {
+      {
+        lock_guard<mutex> lock(workMutex);
+        stopping = true;
+      }
+      workReady.notify_all();
+      for (auto &worker : workers)
+        worker.join();
+    }
+
+    SoftRenderer(const SoftRenderer &) = delete;
+    SoftRenderer &operator=(const SoftRenderer &) = delete;
+
+    const unsigned char *pixels() const
+    {
+      return (const unsigned char *)framebuffer.data();
+    }
+
+    int getWidth() const
+    {
+      return width;
+    }
+
+    int getHeight() const
+    {
+      return height;
+    }
+
+    void render(const SnakeGame &game)
+    {
+      if (game.columns != columns || game.rows != rows)
+      {
+        columns = game.columns;
+        rows = game.rows;
+        cells.assign(columns * rows, CELL_EMPTY);
+        prevCells.assign(columns * rows, CELL_EMPTY);
+        hasFrame = false;
+      }
+
+      fill(cells.begin(), cells.end(), CELL_EMPTY);
+      if (!game.isGameOver)
+      {
+        // Snake is drawn over the fruit, as in the GL renderers
+        cells[game.fruit.y * columns + game.fruit.x] = CELL_FRUIT;
+        for (const auto &segment : game.snakeBody)
+          cells[segment.y * columns + segment.x] = CELL_SNAKE;
+      }
+      buildTexts(game);
+
+      if (!hasFrame || alwaysFull || game.isGameOver != prevGameOver)
+      {
+        markAll();
+      }
+      else
+      {
+        for (int cy = 0; cy < rows; ++cy)
+        {
+          for (int cx = 0; cx < columns; ++cx)
+          {
+            if (cells[cy * columns + cx] != prevCells[cy * columns + cx])
+              markRect(cellRect(cx, cy));
+          }
+        }
+        if (texts != prevTexts)
+        {
+          for (const auto &text : prevTexts)
+            markRect(text.bounds());
+          for (const auto &text : texts)
+            markRect(text.bounds());
+        }
+      }
+
+      lastDirtyTiles = 0;
+      for (unsigned char flag : dirty)
+        lastDirtyTiles += flag;
+
+      // Threads only pay for themselves when a large part of the frame is dirty
+      if (!workers.empty() && lastDirtyTiles * 4 >= (int)dirty.size())
+        renderBanded();
+      else
+        renderBand(0, tileRows);
+
+      fill(dirty.begin(), dirty.end(), 0);
+      cells.swap(prevCells);
+      texts.swap(prevTexts);
+      prevGameOver = game.isGameOver;
+      hasFrame = true;
+    }
+};
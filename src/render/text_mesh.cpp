@@ -0,0 +1,100 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <string>
+#include <vector>
+#include "quad_ring.cpp"
+#include "atlas_rects.h"
+
+using namespace std;
+
+// Glyph rectangles come from the packed atlas (make atlas), indexed from
+// ASCII 32 (space)
+const int fontAtlasFirstChar = 32;
+
+// One string laid out as a single glyph-quad mesh. build() is a no-op while
+// the text and its placement stay the same, so static strings are uploaded
+// once and dynamic ones (the score) only when they actually change. The
+// upload waits for the first draw(), callers batching quads() themselves
+// never upload at all.
+class TextMesh
+{
+  GLuint vbo = 0;
+  vector<Quad> glyphQuads;
+  bool uploaded = false;
+  string builtText;
+  float builtX = 0.0f, builtY = 0.0f, builtScale = 0.0f;
+  bool builtCenter = false;
+  bool built = false;
+
+  public:
+    // Creates the buffer ahead of the first draw(), for callers that keep
+    // frames free of GL object creation
+    void init()
+    {
+      if (!vbo)
+        glGenBuffers(1, &vbo);
+    }
+
+    bool build(const string &text, float x, float y, float scale, bool center = false)
+    {
+      if (built && text == builtText && x == builtX && y == builtY && scale == builtScale && center == builtCenter)
+        return false;
+
+      float penX = center ? x - text.size() * scale / 2.0f : x;
+      glyphQuads.clear();
+      glyphQuads.reserve(text.size());
+      for (char c : text)
+      {
+        int charIndex = (unsigned char)c - fontAtlasFirstChar;
+        if (charIndex < 0)
+          charIndex = 0;
+        const AtlasRect &glyph = fontRects[charIndex % (fontColumns * fontRows)];
+
+        // Atlas rows run top to bottom, flip v
+        glyphQuads.push_back(makeQuad(penX, y, scale, scale, glyph.u1, glyph.v2, glyph.u2, glyph.v1));
+        penX += scale; // Move to the next character position
+      }
+
+      uploaded = false;
+      builtText = text;
+      builtX = x;
+      builtY = y;
+      builtScale = scale;
+      builtCenter = center;
+      built = true;
+      return true;
+    }
+
+    const vector<Quad> &quads() const
+    {
+      return glyphQuads;
+    }
+
+    void draw(GLint posLoc, GLint texLoc)
+    {
+      if (glyphQuads.empty())
+        return;
+
+      if (!vbo)
+        glGenBuffers(1, &vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      if (!uploaded)
+      {
+        glBufferData(GL_ARRAY_BUFFER, glyphQuads.size() * sizeof(Quad), glyphQuads.data(), GL_STATIC_DRAW);
+        uploadStats.frameBytes += glyphQuads.size() * sizeof(Quad);
+        uploadStats.totalBytes += glyphQuads.size() * sizeof(Quad);
+        uploaded = true;
+      }
+
+      glEnableVertexAttribArray(posLoc);
+      glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)0);
+      glEnableVertexAttribArray(texLoc);
+      glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)(2 * sizeof(float)));
+
+      glDrawArrays(GL_TRIANGLES, 0, glyphQuads.size() * 6);
+
+      glDisableVertexAttribArray(posLoc);
+      glDisableVertexAttribArray(texLoc);
+    }
+};
@@ -0,0 +1,73 @@
+// Plays input logs written by --record back through the simulation core as
+// fast as it can, no window or GL, and checks every one ends with the ticks,
+// score and game over it was recorded with. Exits with 1 when a log does not
+// load or does not match, so it can gate CI or verify submitted scores.
+// --repeat plays every log N times, which makes real games a workload for
+// timing the simulation.
+//
+//   replay [--repeat N] FILE...
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "simulation.cpp"
+#include "input_log.cpp"
+
+using namespace std;
+using namespace chrono;
+
+int main(int argc, char **argv)
+{
+  int repeat = 1;
+  vector<string> paths;
+  bool usage = argc < 2;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--repeat" && i + 1 < argc)
+      repeat = max(atoi(argv[++i]), 1);
+    else if (arg.compare(0, 2, "--") != 0)
+      paths.push_back(arg);
+    else
+      usage = true;
+  }
+  if (usage || paths.empty())
+  {
+    cerr << "usage: replay [--repeat N] FILE..." << endl;
+    return 1;
+  }
+
+  bool allMatch = true;
+  uint64_t totalTicks = 0;
+  double seconds = 0.0;
+  for (const string &path : paths)
+  {
+    InputLog log;
+    if (!loadInputLog(path, log))
+    {
+      cerr << "Could not read " << path << endl;
+      allMatch = false;
+      continue;
+    }
+
+    SnakeGame game;
+    ReplayResult result;
+    auto start = steady_clock::now();
+    for (int i = 0; i < repeat; ++i)
+      result = replayInputLog(log, game);
+    seconds += duration<double>(steady_clock::now() - start).count();
+    totalTicks += result.ticks * repeat;
+
+    bool matches = replayMatches(log, result);
+    allMatch = allMatch && matches;
+    cout << path << ": " << (matches ? "ok" : "MISMATCH") << ", " << log.columns << "x" << log.rows << " seed " << log.seed << ", "
+         << log.turnCount << " turns in " << log.turns.size() << " bytes, " << result.ticks << "/" << log.ticks << " ticks, score "
+         << result.score << "/" << log.score << (log.finished ? ", game over" : ", unfinished")
+         << (result.malformed ? ", malformed" : "") << endl;
+  }
+  if (seconds > 0.0)
+    cout << "replayed " << totalTicks << " ticks in " << seconds * 1000.0 << " ms (" << totalTicks / seconds / 1e6 << "M ticks/s)" << endl;
+  return allMatch ? 0 : 1;
+}
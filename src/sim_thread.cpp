@@ -0,0 +1,364 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "simulation.cpp"
+#include "input_log.cpp"
+#include "render/snake_sprites.cpp"
+#include "utils/spsc_queue.cpp"
+#include "utils/triple_buffer.cpp"
+#include "utils/latency_histogram.cpp"
+
+using namespace std;
+
+enum InputCommand
+{
+  COMMAND_LEFT,
+  COMMAND_RIGHT,
+  COMMAND_UP,
+  COMMAND_DOWN,
+  COMMAND_SPACE
+};
+
+// A key press and when it happened
+struct InputEvent
+{
+  InputCommand command;
+  chrono::steady_clock::time_point time;
+};
+
+// Everything a frame needs from one simulation step. delta holds the
+// changes since the previous snapshot, sequence tells the renderer whether
+// it missed any in between. previousBody and tickTime let the renderer
+// interpolate between the last two ticks. inputsTaken counts the events
+// taken off the input queue up to this step.
+struct FrameSnapshot
+{
+  uint64_t sequence = 0;
+  uint64_t inputsTaken = 0;
+  chrono::steady_clock::time_point tickTime;
+  vector<Cell> snakeBody;
+  vector<Cell> previousBody; // the body before the last tick
+  vector<unsigned char> sprites; // snakeSpriteAt() per segment
+  Cell fruit = {0, 0};
+  int playerScore = 0;
+  Direction snakeDirection = NONE;
+  bool isGameOver = false;
+  TickDelta delta;
+};
+
+// Runs the game on its own thread at a fixed tick rate. Input arrives
+// through a lock-free queue of timestamped events. Space is applied between
+// ticks, turns one per tick (or at once to start a standing snake) and only
+// against the direction the snake last moved in, so quick presses are
+// neither lost nor able to fold the snake back into itself. Every step that
+// changed something is published as a snapshot through a triple buffer, so
+// neither side ever waits on the other. The mutex only parks the thread
+// while the snake stands still.
+//
+// Headless runs skip the thread and call step() themselves, which keeps
+// them deterministic.
+class SimThread
+{
+  SpscQueue<InputEvent> input{64};
+  TripleBuffer<FrameSnapshot> snapshots;
+  uint64_t sequence = 0;
+  uint64_t shownSequence = 0; // owned by the consumer
+  uint64_t inputsSent = 0;    // owned by the input thread
+  uint64_t inputsTaken = 0;
+  vector<Cell> previousBody;
+  chrono::steady_clock::time_point lastTick;
+  // The snake's neck lies opposite the way it last moved, also while
+  // paused, when snakeDirection is NONE
+  Direction lastMovedDirection = NONE;
+
+  thread worker;
+  mutex wakeMutex;
+  condition_variable wake;
+  bool stopping = false; // guarded by wakeMutex
+  chrono::steady_clock::duration tickInterval;
+
+  // --record: the current game, saved when it ends
+  string recordPath;
+  InputRecorder recorder;
+
+  bool isMoving() const
+  {
+    return game.snakeDirection != NONE && !game.isGameOver;
+  }
+
+  static Direction turnDirection(InputCommand command)
+  {
+    switch (command)
+    {
+    case COMMAND_LEFT:
+      return LEFT;
+    case COMMAND_RIGHT:
+      return RIGHT;
+    case COMMAND_UP:
+      return UP;
+    case COMMAND_DOWN:
+      return DOWN;
+    default:
+      return NONE;
+    }
+  }
+
+  // Takes events off the queue in order until a turn has been applied or
+  // the next turn has to wait for a later tick. Turns that would not change
+  // the direction or would reverse it are dropped. Returns how many events
+  // were taken, applied says whether any of them changed the game.
+  int applyInput(bool tick, chrono::steady_clock::time_point now, bool &applied)
+  {
+    InputEvent event;
+    bool turned = false;
+    int taken = 0;
+    applied = false;
+    while (input.front(event))
+    {
+      Direction direction = turnDirection(event.command);
+      if (direction != NONE && !game.isGameOver && (turned || !(tick || game.snakeDirection == NONE)))
+        break;
+      input.pop(event);
+      taken++;
+      if (direction == NONE)
+      {
+        bool restarting = game.isGameOver;
+        uint32_t seed = random_device()();
+        pauseOrRestart(game, seed);
+        if (restarting)
+          lastMovedDirection = NONE;
+        if (restarting && isRecording())
+          recorder.begin(game, seed, (int)chrono::duration_cast<chrono::milliseconds>(tickInterval).count());
+        applied = true;
+      }
+      else if (game.isGameOver || direction == game.snakeDirection || isReversal(direction, lastMovedDirection))
+      {
+        droppedTurns++;
+      }
+      else
+      {
+        game.snakeDirection = direction;
+        if (isRecording())
+          recorder.turn(direction);
+        turnLatency.record(now - event.time);
+        applied = turned = true;
+      }
+    }
+    inputsTaken += taken;
+    return taken;
+  }
+
+  void run()
+  {
+    profiler.nameThread("simulation");
+    auto nextTick = chrono::steady_clock::now() + tickInterval;
+    unique_lock<mutex> lock(wakeMutex);
+    while (!stopping)
+    {
+      // Turns queued while moving wait for the tick anyway
+      bool moving = isMoving();
+      if (moving)
+        wake.wait_until(lock, nextTick);
+      else if (input.size() == 0)
+        wake.wait(lock);
+      if (stopping)
+        break;
+      lock.unlock();
+
+      auto now = chrono::steady_clock::now();
+      bool tick = moving && now >= nextTick;
+      if (tick)
+      {
+        // Keep the schedule, unless the thread was starved for whole ticks
+        nextTick += tickInterval;
+        if (nextTick <= now)
+          nextTick = now + tickInterval;
+      }
+      else if (!moving)
+      {
+        nextTick = now + tickInterval;
+      }
+      step(tick, now);
+      lock.lock();
+    }
+  }
+
+  public:
+    // Owned by the simulation thread while it runs
+    SnakeGame game;
+    LatencyHistogram turnLatency; // key press to the tick that turned
+    int droppedTurns = 0;
+    atomic<uint64_t> ticks{0}; // steps that ticked, read by the HUD
+
+    ~SimThread()
+    {
+      stop();
+    }
+
+    // Starts a game, before start() or from the simulation thread
+    void newGame(uint32_t seed)
+    {
+      resetGame(game, seed);
+      lastMovedDirection = NONE;
+      if (isRecording())
+        recorder.begin(game, seed, (int)chrono::duration_cast<chrono::milliseconds>(tickInterval).count());
+    }
+
+    // Logs every game to path from the next newGame() on. A game is saved
+    // when it ends, replacing the one before, and by saveRecording() once
+    // the snake has moved.
+    void record(const string &path, chrono::steady_clock::duration interval)
+    {
+      recordPath = path;
+      tickInterval = interval;
+    }
+
+    bool isRecording() const
+    {
+      return !recordPath.empty();
+    }
+
+    // Saves the game so far, call with the thread stopped. A game the snake
+    // has not moved in yet, such as the one after a restart, leaves the
+    // last saved game alone.
+    bool saveRecording()
+    {
+      return !isRecording() || recorder.empty() || saveInputLog(recordPath, recorder.finish(game));
+    }
+
+    void start(chrono::steady_clock::duration interval)
+    {
+      tickInterval = interval;
+      stopping = false;
+      worker = thread(&SimThread::run, this);
+    }
+
+    void stop()
+    {
+      if (!worker.joinable())
+        return;
+      {
+        lock_guard<mutex> lock(wakeMutex);
+        stopping = true;
+      }
+      wake.notify_one();
+      worker.join();
+    }
+
+    // Input thread: queues a command pressed at time for the next step. A
+    // full queue drops it.
+    void send(InputCommand command, chrono::steady_clock::time_point time = chrono::steady_clock::now())
+    {
+      if (input.push({command, time}))
+        inputsSent++;
+      lock_guard<mutex> lock(wakeMutex);
+      wake.notify_one();
+    }
+
+    // Applies queued input, advances the game by one tick if asked to and
+    // publishes the result when anything changed or input was taken, even
+    // input that was dropped. now stamps the tick, headless runs pass their
+    // simulated clock.
+    void step(bool tick, chrono::steady_clock::time_point now = chrono::steady_clock::now())
+    {
+      bool changed;
+      int taken = applyInput(tick, now, changed);
+      if (game.delta.reset)
+        previousBody = game.snakeBody; // a new game does not slide in
+      if (tick)
+      {
+        previousBody = game.snakeBody;
+        lastTick = now;
+        bool moving = isMoving();
+        if (moving)
+          lastMovedDirection = game.snakeDirection;
+        moveSnake(game);
+        checkCollisions(game);
+        if (moving && isRecording())
+        {
+          recorder.tick();
+          if (game.isGameOver)
+            saveRecording();
+        }
+        ticks.fetch_add(1, memory_order_relaxed);
+        changed = true;
+      }
+      if (changed || taken > 0 || game.delta.reset)
+        publish();
+    }
+
+    void publish()
+    {
+      FrameSnapshot &snapshot = snapshots.writeSlot();
+      snapshot.sequence = ++sequence;
+      snapshot.inputsTaken = inputsTaken;
+      snapshot.tickTime = lastTick;
+      snapshot.snakeBody = game.snakeBody;
+      snapshot.previousBody = previousBody;
+      snapshot.sprites.resize(game.snakeBody.size());
+      for (size_t i = 0; i < game.snakeBody.size(); ++i)
+        snapshot.sprites[i] = snakeSpriteAt(game, i);
+      snapshot.fruit = game.fruit;
+      snapshot.playerScore = game.playerScore;
+      snapshot.snakeDirection = game.snakeDirection;
+      snapshot.isGameOver = game.isGameOver;
+      snapshot.delta = game.delta;
+      clearDelta(game);
+      snapshots.publish();
+    }
+
+    // Render thread: true when a snapshot newer than the last one read waits
+    bool hasFreshSnapshot() const
+    {
+      return snapshots.hasFresh();
+    }
+
+    // Input thread, when it also renders: true until readLatest() has taken
+    // a snapshot that includes every event sent so far
+    bool awaitsInput() const
+    {
+      return snapshots.read().inputsTaken < inputsSent;
+    }
+
+    // Render thread: the snapshot last taken by readLatest(), valid until
+    // the next call
+    const FrameSnapshot &latest() const
+    {
+      return snapshots.read();
+    }
+
+    // Render thread: copies the newest snapshot into view and adds its delta
+    // to whatever view has not consumed yet. Skipped snapshots took their
+    // deltas with them, so view is rebuilt from scratch then (their events
+    // are simply missed).
+    bool readLatest(SnakeGame &view)
+    {
+      if (!snapshots.update())
+        return false;
+      const FrameSnapshot &snapshot = snapshots.read();
+      view.snakeBody = snapshot.snakeBody;
+      view.fruit = snapshot.fruit;
+      view.playerScore = snapshot.playerScore;
+      view.snakeDirection = snapshot.snakeDirection;
+      view.isGameOver = snapshot.isGameOver;
+
+      if (snapshot.sequence != shownSequence + 1)
+        view.delta.reset = true;
+      view.delta.reset = view.delta.reset || snapshot.delta.reset;
+      view.delta.fruitMoved = view.delta.fruitMoved || snapshot.delta.fruitMoved;
+      for (const auto &entry : snapshot.delta.ops)
+        recordDelta(view, entry.op, entry.cell);
+      for (const auto &entry : snapshot.delta.events)
+        recordEvent(view, entry.event, entry.cell);
+      shownSequence = snapshot.sequence;
+      return true;
+    }
+};
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <random>
+#include "utils/profiler.cpp"
+
+using namespace std;
+
+// Board cell, (0, 0) is the bottom left corner
+struct Cell
+{
+  int x, y;
+};
+
+inline bool operator==(const Cell &a, const Cell &b)
+{
+  return a.x == b.x && a.y == b.y;
+}
+
+enum Direction
+{
+  NONE,
+  LEFT,
+  RIGHT,
+  UP,
+  DOWN
+};
+
+// What a cell shows, as stored in the board and wall textures
+enum CellState
+{
+  CELL_EMPTY = 0,
+  CELL_BODY = 1,
+  CELL_HEAD = 2,
+  CELL_FRUIT = 3
+};
+
+// Per-tick changes to the snake, in the order they happened. Renderers
+// replay these against their own copy of the body instead of rebuilding it.
+enum DeltaOp
+{
+  PUSH_HEAD,
+  POP_TAIL,
+  PUSH_TAIL
+};
+
+struct DeltaEntry
+{
+  DeltaOp op;
+  Cell cell;
+};
+
+// Moments worth an effect, where they happened
+enum GameEvent
+{
+  EVENT_FRUIT_EATEN,
+  EVENT_GAME_OVER
+};
+
+struct GameEventEntry
+{
+  GameEvent event;
+  Cell cell;
+};
+
+struct TickDelta
+{
+  bool reset = true; // body replaced wholesale, consumers must rebuild
+  bool fruitMoved = true;
+  vector<DeltaEntry> ops;
+  vector<GameEventEntry> events; // kept across resets, effects outlive the body
+};
+
+// Deltas that pile up without being consumed are folded into a reset
+const size_t maxPendingDeltaOps = 1024;
+
+struct SnakeGame
+{
+  int columns = 40;
+  int rows = 40;
+  vector<Cell> snakeBody;
+  Direction snakeDirection = NONE;
+  bool isGameOver = false;
+  int playerScore = 0;
+  Cell fruit = {0, 0};
+  mt19937 rng;
+  TickDelta delta;
+};
+
+void recordDelta(SnakeGame &game, DeltaOp op, const Cell &cell)
+{
+  if (game.delta.reset)
+    return;
+  if (game.delta.ops.size() >= maxPendingDeltaOps)
+  {
+    game.delta.reset = true;
+    game.delta.ops.clear();
+    return;
+  }
+  game.delta.ops.push_back({op, cell});
+}
+
+void recordEvent(SnakeGame &game, GameEvent event, const Cell &cell)
+{
+  if (game.delta.events.size() < maxPendingDeltaOps)
+    game.delta.events.push_back({event, cell});
+}
+
+void clearDelta(SnakeGame &game)
+{
+  game.delta.reset = false;
+  game.delta.fruitMoved = false;
+  game.delta.ops.clear();
+  game.delta.events.clear();
+}
+
+bool isOnSnake(const SnakeGame &game, const Cell &cell)
+{
+  for (const auto &segment : game.snakeBody)
+  {
+    if (segment == cell)
+      return true;
+  }
+  return false;
+}
+
+// A number in [0, n) from one draw of the generator, by multiply and shift.
+// Unlike the standard distributions, whose algorithms differ between
+// libraries, this gives the same fruit everywhere, so recorded games replay
+// on any build. The bias is below n / 2^32.
+uint32_t randomBelow(mt19937 &rng, uint32_t n)
+{
+  return (uint32_t)(((uint64_t)(uint32_t)rng() * n) >> 32);
+}
+
+// Random probing is fast on a sparse board. After a few misses the board is
+// crowded enough to be worth an occupancy map, built once in O(cells +
+// length), which makes every further probe O(1). When 64 probes miss, the
+// fruit goes to a random free cell counted off the map. Both ways draw
+// from the generator exactly as checking the body would.
+void placeFruit(SnakeGame &game)
+{
+  PROFILE_SCOPE("placeFruit");
+  vector<unsigned char> occupied;
+  auto isFree = [&](const Cell &cell) {
+    if (occupied.empty())
+      return !isOnSnake(game, cell);
+    return !occupied[(size_t)cell.y * game.columns + cell.x];
+  };
+  auto buildMap = [&]() {
+    occupied.assign((size_t)game.columns * game.rows, 0);
+    for (const auto &segment : game.snakeBody)
+      occupied[(size_t)segment.y * game.columns + segment.x] = 1;
+  };
+
+  for (int attempt = 0; attempt < 64; ++attempt)
+  {
+    if (attempt == 4)
+      buildMap();
+    Cell cell;
+    cell.x = randomBelow(game.rng, game.columns);
+    cell.y = randomBelow(game.rng, game.rows);
+    if (isFree(cell))
+    {
+      game.fruit = cell;
+      game.delta.fruitMoved = true;
+      return;
+    }
+  }
+
+  size_t freeCount = occupied.size() - count(occupied.begin(), occupied.end(), 1);
+  if (freeCount == 0)
+    return;
+  size_t pick = randomBelow(game.rng, freeCount);
+  for (size_t index = 0;; ++index)
+  {
+    if (!occupied[index] && pick-- == 0)
+    {
+      game.fruit = {(int)(index % game.columns), (int)(index / game.columns)};
+      break;
+    }
+  }
+  game.delta.fruitMoved = true;
+}
+
+void resetGame(SnakeGame &game, unsigned seed)
+{
+  game.rng.seed(seed);
+  game.snakeBody = {{game.columns / 2, game.rows / 2}};
+  game.snakeDirection = NONE;
+  game.isGameOver = false;
+  game.playerScore = 0;
+  game.delta.reset = true;
+  game.delta.ops.clear();
+  placeFruit(game);
+}
+
+// Movement Logic
+void moveSnake(SnakeGame &game)
+{
+  PROFILE_SCOPE("moveSnake");
+  if (game.snakeDirection == NONE || game.isGameOver)
+    return;
+
+  Cell head = game.snakeBody[0];
+  switch (game.snakeDirection)
+  {
+  case LEFT:
+    head.x -= 1;
+    break;
+  case RIGHT:
+    head.x += 1;
+    break;
+  case UP:
+    head.y += 1;
+    break;
+  case DOWN:
+    head.y -= 1;
+    break;
+  default:
+    break;
+  }
+
+  // Wrap around
+  if (head.x < 0)
+    head.x = game.columns - 1;
+  if (head.x >= game.columns)
+    head.x = 0;
+  if (head.y < 0)
+    head.y = game.rows - 1;
+  if (head.y >= game.rows)
+    head.y = 0;
+
+  // Move body, every segment takes the place of the one in front
+  Cell tail = game.snakeBody.back();
+  for (size_t i = game.snakeBody.size() - 1; i > 0; --i)
+    game.snakeBody[i] = game.snakeBody[i - 1];
+  game.snakeBody[0] = head;
+
+  recordDelta(game, PUSH_HEAD, head);
+  recordDelta(game, POP_TAIL, tail);
+}
+
+// Collision Logic
+void checkCollisions(SnakeGame &game)
+{
+  PROFILE_SCOPE("checkCollisions");
+  // Check self-collision
+  for (size_t i = 1; i < game.snakeBody.size(); ++i)
+  {
+    if (game.snakeBody[0] == game.snakeBody[i])
+    {
+      game.isGameOver = true;
+      recordEvent(game, EVENT_GAME_OVER, game.snakeBody[0]);
+      return;
+    }
+  }
+
+  // Check fruit collision
+  if (game.snakeBody[0] == game.fruit)
+  {
+    game.playerScore += 10;
+    recordEvent(game, EVENT_FRUIT_EATEN, game.fruit);
+    game.snakeBody.push_back(game.snakeBody.back());
+    recordDelta(game, PUSH_TAIL, game.snakeBody.back());
+    placeFruit(game);
+  }
+}
+
+bool isReversal(Direction direction, Direction current)
+{
+  return (direction == LEFT && current == RIGHT) || (direction == RIGHT && current == LEFT) || (direction == UP && current == DOWN) ||
+         (direction == DOWN && current == UP);
+}
+
+// Turns the snake, it can never reverse into itself
+void steer(SnakeGame &game, Direction direction)
+{
+  if (isReversal(direction, game.snakeDirection))
+    return;
+  game.snakeDirection = direction;
+}
+
+// Space pauses a moving snake and starts a new game after game over
+void pauseOrRestart(SnakeGame &game, unsigned seed)
+{
+  if (game.isGameOver)
+    resetGame(game, seed);
+  else
+    game.snakeDirection = NONE;
+}
+
+// Greedy autopilot used by headless runs: head for the fruit along the
+// shorter way around the board, never reversing and avoiding the body when
+// another turn is free
+Direction steerTowardsFruit(const SnakeGame &game)
+{
+  const Cell head = game.snakeBody[0];
+  int dx = game.fruit.x - head.x;
+  int dy = game.fruit.y - head.y;
+  if (dx > game.columns / 2)
+    dx -= game.columns;
+  if (dx < -game.columns / 2)
+    dx += game.columns;
+  if (dy > game.rows / 2)
+    dy -= game.rows;
+  if (dy < -game.rows / 2)
+    dy += game.rows;
+
+  Direction preferred[4];
+  int count = 0;
+  if (dx < 0)
+    preferred[count++] = LEFT;
+  if (dx > 0)
+    preferred[count++] = RIGHT;
+  if (dy > 0)
+    preferred[count++] = UP;
+  if (dy < 0)
+    preferred[count++] = DOWN;
+  const Direction all[4] = {LEFT, RIGHT, UP, DOWN};
+  for (Direction direction : all)
+  {
+    bool listed = false;
+    for (int i = 0; i < count; ++i)
+      listed = listed || preferred[i] == direction;
+    if (!listed)
+      preferred[count++] = direction;
+  }
+
+  Direction fallback = game.snakeDirection;
+  for (int i = 0; i < count; ++i)
+  {
+    Direction direction = preferred[i];
+    if (isReversal(direction, game.snakeDirection))
+      continue;
+
+    Cell next = head;
+    next.x += direction == LEFT ? -1 : direction == RIGHT ? 1 : 0;
+    next.y += direction == DOWN ? -1 : direction == UP ? 1 : 0;
+    next.x = (next.x + game.columns) % game.columns;
+    next.y = (next.y + game.rows) % game.rows;
+    if (!isOnSnake(game, next))
+      return direction;
+    if (fallback == NONE)
+      fallback = direction;
+  }
+  return fallback;
+}
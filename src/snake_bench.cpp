@@ -0,0 +1,337 @@
+// Microbenchmarks for the game's hot paths: moving the snake and checking
+// collisions at lengths 1 to 2500, placing fruit on boards 0% to 99% full,
+// picking sprite tiles, Hashtable::get and intToStr. Every benchmark is
+// warmed up, then timed in samples of about 2 ms; the slowest and fastest
+// fifth of the samples are dropped and the rest averaged. Results go to
+// stdout, or as JSON to --json. With --baseline, a benchmark more than
+// --threshold percent (default 15) slower than in the saved JSON, by median
+// and by min alike, is measured again up to twice. If the best of the runs
+// is still slower it is flagged and the exit code is 1.
+//
+//   snake_bench [--filter TEXT] [--samples N] [--json FILE] [--baseline FILE] [--threshold PERCENT]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#include "simulation.cpp"
+#include "render/snake_sprites.cpp"
+#include "utils/hashmap.cpp"
+#include "utils/utils.cpp"
+
+using namespace std;
+using namespace chrono;
+
+// Keeps the compiler from dropping a result nobody reads
+template <typename T> void keep(const T &value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Benchmark
+{
+  string name;
+  function<void(size_t)> run; // runs the operation n times
+};
+
+struct Result
+{
+  string name;
+  double nsPerOp;  // trimmed mean
+  double median;
+  double min;
+  double spread;   // standard deviation of the kept samples, percent of the mean
+  size_t iterations; // per sample
+  int samples;
+};
+
+const double sampleSeconds = 0.002;
+const double warmupSeconds = 0.05;
+
+double secondsFor(const Benchmark &benchmark, size_t iterations)
+{
+  auto start = steady_clock::now();
+  benchmark.run(iterations);
+  return duration<double>(steady_clock::now() - start).count();
+}
+
+Result measure(const Benchmark &benchmark, int sampleCount)
+{
+  // Warm up caches and branch predictors while finding how many iterations
+  // fill a sample
+  size_t iterations = 1;
+  double spent = 0.0, last = 0.0;
+  while (spent < warmupSeconds || last < sampleSeconds / 2)
+  {
+    last = secondsFor(benchmark, iterations);
+    spent += last;
+    if (last < sampleSeconds)
+      iterations = last > 0.0 ? max(iterations + 1, (size_t)(iterations * sampleSeconds / last)) : iterations * 2;
+    if (spent > 1.0)
+      break; // one iteration takes longer than a sample
+  }
+
+  vector<double> ns(sampleCount);
+  for (double &sample : ns)
+    sample = secondsFor(benchmark, iterations) * 1e9 / iterations;
+  sort(ns.begin(), ns.end());
+
+  // Interruptions only ever make samples slower, but drop both ends alike
+  size_t trim = ns.size() / 5;
+  double sum = 0.0, squares = 0.0;
+  for (size_t i = trim; i < ns.size() - trim; ++i)
+    sum += ns[i];
+  size_t kept = ns.size() - 2 * trim;
+  double mean = sum / kept;
+  for (size_t i = trim; i < ns.size() - trim; ++i)
+    squares += (ns[i] - mean) * (ns[i] - mean);
+
+  Result result;
+  result.name = benchmark.name;
+  result.nsPerOp = mean;
+  result.median = ns[ns.size() / 2];
+  result.min = ns.front();
+  result.spread = mean > 0.0 ? sqrt(squares / kept) / mean * 100.0 : 0.0;
+  result.iterations = iterations;
+  result.samples = sampleCount;
+  return result;
+}
+
+// A snake of length cells laid out row by row, turning at every edge like a
+// long game's snake. The tail starts at the bottom left corner and the head
+// moves on along the row it ends in. Delta recording stays off, like a
+// renderer that rebuilds every frame.
+shared_ptr<SnakeGame> snakeOfLength(int length, int columns, int rows)
+{
+  shared_ptr<SnakeGame> game(new SnakeGame());
+  game->columns = columns;
+  game->rows = rows;
+  resetGame(*game, 1);
+  game->snakeBody.resize(length);
+  for (int i = 0; i < length; ++i)
+  {
+    int y = i / columns;
+    int x = y % 2 == 0 ? i % columns : columns - 1 - i % columns;
+    game->snakeBody[length - 1 - i] = Cell{x, y};
+  }
+  game->snakeDirection = ((length - 1) / columns) % 2 == 0 ? RIGHT : LEFT;
+  game->fruit = {columns - 1, rows - 1};
+  game->delta.reset = true;
+  return game;
+}
+
+vector<Benchmark> benchmarks()
+{
+  vector<Benchmark> list;
+  const int lengths[] = {1, 10, 100, 1000, 2500};
+  for (int length : lengths)
+  {
+    // Games are built once, outside the timed loops
+    shared_ptr<SnakeGame> moving = snakeOfLength(length, 80, 80);
+    list.push_back({"moveSnake/" + to_string(length), [moving](size_t n) {
+                      for (size_t i = 0; i < n; ++i)
+                        moveSnake(*moving);
+                      keep(moving->snakeBody[0]);
+                    }});
+  }
+  for (int length : lengths)
+  {
+    // Never runs into itself or the fruit, so every call walks the whole body
+    shared_ptr<SnakeGame> colliding = snakeOfLength(length, 80, 80);
+    list.push_back({"checkCollisions/" + to_string(length), [colliding](size_t n) {
+                      for (size_t i = 0; i < n; ++i)
+                        checkCollisions(*colliding);
+                      keep(colliding->isGameOver);
+                    }});
+  }
+
+  const int fills[] = {0, 25, 50, 75, 90, 99};
+  for (int fill : fills)
+  {
+    shared_ptr<SnakeGame> game = snakeOfLength(max(40 * 40 * fill / 100, 1), 40, 40);
+    list.push_back({"placeFruit/" + to_string(fill) + "%", [game](size_t n) {
+                      for (size_t i = 0; i < n; ++i)
+                        placeFruit(*game);
+                      keep(game->fruit);
+                    }});
+  }
+
+  // Per segment of a 1000 long snake, with a turn every row
+  shared_ptr<SnakeGame> sprites = snakeOfLength(1000, 40, 40);
+  list.push_back({"snakeSpriteAt", [sprites](size_t n) {
+                    int sum = 0;
+                    for (size_t i = 0; i < n; ++i)
+                      sum += snakeSpriteAt(*sprites, i % sprites->snakeBody.size());
+                    keep(sum);
+                  }});
+
+  // Key codes, like the original key bindings
+  static Hashtable<int, int> table;
+  for (int key = 0; key < 1000; ++key)
+    table.put(key * 7, key);
+  list.push_back({"Hashtable::get/hit", [](size_t n) {
+                    int sum = 0;
+                    for (size_t i = 0; i < n; ++i)
+                      sum += table.get((int)(i % 1000) * 7);
+                    keep(sum);
+                  }});
+  list.push_back({"Hashtable::get/miss", [](size_t n) {
+                    int sum = 0;
+                    for (size_t i = 0; i < n; ++i)
+                      sum += table.get((int)(i % 1000) * 7 + 1);
+                    keep(sum);
+                  }});
+
+  list.push_back({"intToStr", [](size_t n) {
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                      const char *text = intToStr((int)(i % 100000) * 10);
+                      keep(text[0]);
+                      delete[] text;
+                    }
+                  }});
+  return list;
+}
+
+void writeJson(ostream &out, const vector<Result> &results)
+{
+  out << "{\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const Result &r = results[i];
+    char line[256];
+    snprintf(line, sizeof(line),
+             "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"median\": %.3f, \"min\": %.3f, \"spread_percent\": %.2f, \"iterations\": %zu, \"samples\": %d}",
+             r.name.c_str(), r.nsPerOp, r.median, r.min, r.spread, r.iterations, r.samples);
+    out << line << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+}
+
+// Reads name, median and min back from a file writeJson() wrote
+bool readBaseline(const string &path, map<string, Result> &baseline)
+{
+  ifstream file(path);
+  if (!file)
+    return false;
+  string line;
+  while (getline(file, line))
+  {
+    size_t name = line.find("\"name\": \"");
+    size_t median = line.find("\"median\": ");
+    size_t min = line.find("\"min\": ");
+    if (name == string::npos || median == string::npos || min == string::npos)
+      continue;
+    name += 9;
+    Result &result = baseline[line.substr(name, line.find('"', name) - name)];
+    result.median = atof(line.c_str() + median + 10);
+    result.min = atof(line.c_str() + min + 7);
+  }
+  return true;
+}
+
+// Percent slower than the baseline, by median and by min
+double changeOf(double now, double before)
+{
+  return (now / before - 1.0) * 100.0;
+}
+
+// A background job slows the median of a run but seldom its fastest sample,
+// so only a benchmark slower by both counts as a regression
+bool regressedFrom(const Result &result, const Result &before, double threshold)
+{
+  return changeOf(result.median, before.median) > threshold && changeOf(result.min, before.min) > threshold;
+}
+
+int main(int argc, char **argv)
+{
+  string filter, jsonPath, baselinePath;
+  int samples = 25;
+  double threshold = 15.0;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc)
+      filter = argv[++i];
+    else if (arg == "--samples" && i + 1 < argc)
+      samples = max(atoi(argv[++i]), 5);
+    else if (arg == "--json" && i + 1 < argc)
+      jsonPath = argv[++i];
+    else if (arg == "--baseline" && i + 1 < argc)
+      baselinePath = argv[++i];
+    else if (arg == "--threshold" && i + 1 < argc)
+      threshold = atof(argv[++i]);
+    else
+    {
+      cerr << "usage: snake_bench [--filter TEXT] [--samples N] [--json FILE] [--baseline FILE] [--threshold PERCENT]" << endl;
+      return 1;
+    }
+  }
+
+  map<string, Result> baseline;
+  if (!baselinePath.empty() && !readBaseline(baselinePath, baseline))
+  {
+    cerr << "Could not read " << baselinePath << endl;
+    return 1;
+  }
+
+  vector<Result> results;
+  int regressions = 0;
+  printf("%-24s %12s %12s %12s %8s%s\n", "benchmark", "ns/op", "median", "min", "spread", baseline.empty() ? "" : "   vs baseline");
+  for (const Benchmark &benchmark : benchmarks())
+  {
+    if (benchmark.name.find(filter) == string::npos)
+      continue;
+    Result result = measure(benchmark, samples);
+    auto before = baseline.find(result.name);
+    bool compared = before != baseline.end() && before->second.median > 0.0 && before->second.min > 0.0;
+    bool regressed = compared && regressedFrom(result, before->second, threshold);
+    int retries = 0;
+    for (; regressed && retries < 2; ++retries)
+    {
+      // Keep the faster run, a slowdown has to show up every time
+      Result again = measure(benchmark, samples);
+      if (again.median < result.median)
+        result = again;
+      regressed = regressedFrom(result, before->second, threshold);
+    }
+    results.push_back(result);
+    printf("%-24s %12.2f %12.2f %12.2f %7.1f%%", result.name.c_str(), result.nsPerOp, result.median, result.min, result.spread);
+    if (compared)
+    {
+      regressions += regressed;
+      printf("   %+7.1f%%%s", changeOf(result.median, before->second.median), regressed ? "  REGRESSION" : "");
+      if (retries > 0)
+        printf("  (%d runs)", retries + 1);
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+
+  if (!jsonPath.empty())
+  {
+    ofstream json(jsonPath);
+    writeJson(json, results);
+    if (!json)
+    {
+      cerr << "Could not write " << jsonPath << endl;
+      return 1;
+    }
+  }
+  if (regressions > 0)
+  {
+    printf("%d benchmark%s more than %.0f%% slower than %s\n", regressions, regressions == 1 ? "" : "s", threshold, baselinePath.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -1,148 +1,192 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include <GL/glut.h>
+#include "render/gl_counters.cpp"
 #include <iostream>
 #include <vector>
 #include <chrono>
 #include <random>
 #include <string>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "sim_thread.cpp"
+#include "render/quad_ring.cpp"
+#include "render/text_mesh.cpp"
+#include "render/chunked_board.cpp"
+#include "render/board_texture.cpp"
+#include "render/smooth_snake.cpp"
+#include "render/particles.cpp"
+#include "render/board_wall.cpp"
+#include "platform/headless.cpp"
+#include "render/frame_capture.cpp"
+#include "render/cooked_texture.cpp"
+#include "render/perf_hud.cpp"
+#include "utils/alloc_counter.cpp"
 
 using namespace std;
 using namespace chrono;
 
+const char atlasTexturePath[18] = "web/res/atlas.png";
+
 // Constants
-const int columns = 40;
-const int rows = 40;
+int columns = 40; // --board COLUMNS ROWS
+int rows = 40;
 const int frame_rate = 30;
 int snakeSpeed = 10;
-float snakeWidth, snakeHeight;
-bool isGameOver = false;
-int playerScore = 0;
 
-// Snake Properties
-struct SnakeSegment
-{
-  float x, y;
-};
-vector<SnakeSegment> snakeBody = {{0.0f, 0.0f}};
-enum Direction
-{
-  NONE,
-  LEFT,
-  RIGHT,
-  UP,
-  DOWN
-};
-Direction snakeDirection = NONE;
+// Game State. The simulation thread owns the live game, the renderer draws
+// game as of the latest snapshot.
+SimThread sim;
+SnakeGame game;
 
-// Fruit Position
-float fruitX, fruitY;
+// Interpolated rendering (--smooth [HZ]): while the snake moves, frames are
+// drawn at the display's refresh rate with every segment placed between its
+// last two cells. Ticks and rules stay the same.
+bool smoothMotion = false;
+int refreshRate = 144;
+SmoothSnake smoothSnake;
 
-// Random Generator for Fruit
-float getRandomCoord()
+int renderRate()
 {
-  static random_device rd;
-  static mt19937 gen(rd());
-  uniform_real_distribution<float> dis(-1.0f + snakeWidth / 2, 1.0f - snakeWidth / 2);
-  return dis(gen);
+  return smoothMotion ? refreshRate : frame_rate;
 }
 
-void placeFruit()
+const std::chrono::milliseconds moveInterval((int)(100 / (0.1f * snakeSpeed)));
+
+// Headless runs render on a simulated clock
+std::chrono::steady_clock::time_point simulatedNow;
+
+// When a key was pressed, on the same clock as the ticks
+std::chrono::steady_clock::time_point inputTime()
 {
-  fruitX = getRandomCoord();
-  fruitY = getRandomCoord();
+  return headless ? simulatedNow : std::chrono::steady_clock::now();
 }
 
-// Movement Logic
-void moveSnake()
+// How far the frame is between the last tick and the next, 0 to 1
+float tickAlpha()
 {
-  if (snakeDirection == NONE || isGameOver)
-    return;
+  auto now = headless ? simulatedNow : std::chrono::steady_clock::now();
+  float alpha = std::chrono::duration<float, std::milli>(now - sim.latest().tickTime).count() / moveInterval.count();
+  return min(max(alpha, 0.0f), 1.0f);
+}
 
-  float prevX = snakeBody[0].x;
-  float prevY = snakeBody[0].y;
+// Spectator wall (--wall N): N autopilot games from the batch simulation,
+// drawn side by side in one window instead of the playable game
+int wallBoards = 0;
+BatchSimulation wall;
+BoardWall boardWall;
+GLuint wallProgram;
 
-  // Move head
-  switch (snakeDirection)
-  {
-  case LEFT:
-    snakeBody[0].x -= snakeWidth;
-    break;
-  case RIGHT:
-    snakeBody[0].x += snakeWidth;
-    break;
-  case UP:
-    snakeBody[0].y += snakeHeight;
-    break;
-  case DOWN:
-    snakeBody[0].y -= snakeHeight;
-    break;
-  default:
-    break;
-  }
+// Print buffer upload statistics once a second (--stats), and input latency
+// at exit
+bool printStats = false;
 
-  // Wrap around
-  if (snakeBody[0].x < -1.0f)
-    snakeBody[0].x = 1.0f;
-  if (snakeBody[0].x > 1.0f)
-    snakeBody[0].x = -1.0f;
-  if (snakeBody[0].y < -1.0f)
-    snakeBody[0].y = 1.0f;
-  if (snakeBody[0].y > 1.0f)
-    snakeBody[0].y = -1.0f;
+// Input log of the current game (--record FILE), played back by make replay
+string recordPath;
 
-  // Move body
-  for (size_t i = 1; i < snakeBody.size(); ++i)
-  {
-    float tempX = snakeBody[i].x;
-    float tempY = snakeBody[i].y;
-    snakeBody[i].x = prevX;
-    snakeBody[i].y = prevY;
-    prevX = tempX;
-    prevY = tempY;
-  }
-}
+// Chrome trace of the frame timers (--profile FILE), written at exit and
+// when P is pressed
+string profilePath;
 
-// Check Collisions
-void checkCollisions()
-{
-  // Check self-collision
-  for (size_t i = 1; i < snakeBody.size(); ++i)
-  {
-    if (snakeBody[0].x == snakeBody[i].x && snakeBody[0].y == snakeBody[i].y)
-    {
-      isGameOver = true;
-      return;
-    }
-  }
+// Performance overlay, toggled with H (or shown from the start with --hud)
+PerfHud hud;
+uint64_t frameStartAllocations = 0;
 
-  // Check fruit collision
-  if (abs(snakeBody[0].x - fruitX) < snakeWidth && abs(snakeBody[0].y - fruitY) < snakeHeight)
-  {
-    playerScore += 10;
-    placeFruit();
-    snakeBody.push_back({snakeBody.back().x, snakeBody.back().y});
-  }
-}
+// GL counters per frame to a CSV (--gl-csv FILE) and checked against limits
+// (--gl-budget draws=N,upload_bytes=N,...), a headless run over budget fails
+GLFrameLog glFrameLog;
+
+// Frames are only drawn when something visible changed
+bool frameDirty = true;
+
+// Video export (--capture FILE.y4m|DIR)
+FrameCapture frameCapture;
+const int windowWidth = 800;
+const int windowHeight = 800;
+int viewportWidth = windowWidth, viewportHeight = windowHeight; // set by reshape
 
 // Shader Source
 const char *vertexShaderSource = R"(
     attribute vec2 aPosition;
+    attribute vec2 aTexCoord;
+    uniform vec4 uTransform;
+    varying vec2 vTexCoord;
+
     void main() {
-        gl_Position = vec4(aPosition, 0.0, 1.0);
+        vTexCoord = aTexCoord;
+        gl_Position = vec4(aPosition * uTransform.xy + uTransform.zw, 0.0, 1.0);
     }
 )";
 
 const char *fragmentShaderSource = R"(
-    uniform vec3 uColor;
+  precision mediump float;
+  uniform vec3 uColor;
+  uniform sampler2D uTexture;
+  uniform bool uUseTexture;
+  varying vec2 vTexCoord;
+
+  void main() {
+    if (uUseTexture) {
+      gl_FragColor = vec4(uColor, 1.0) * texture2D(uTexture, vTexCoord);
+    } else {
+      gl_FragColor = vec4(uColor, 1.0);
+    }
+  }
+)";
+
+// The board as one fullscreen quad: every pixel finds its cell in the view
+// and looks the cell up in the board texture
+const char *boardVertexShaderSource = R"(
+    attribute vec2 aPosition;
+    uniform vec4 uView;
+    varying vec2 vCell;
+
     void main() {
-        gl_FragColor = vec4(uColor, 1.0);
+        vCell = uView.xy + (aPosition * 0.5 + 0.5) * uView.zw;
+        gl_Position = vec4(aPosition, 0.0, 1.0);
     }
 )";
 
+const char *boardFragmentShaderSource = R"(
+  #ifdef GL_FRAGMENT_PRECISION_HIGH
+  precision highp float;
+  #else
+  precision mediump float;
+  #endif
+  uniform sampler2D uBoard;
+  uniform sampler2D uAtlas;
+  uniform vec2 uBoardSize;
+  uniform bool uWrap;
+  uniform vec4 uSpriteRects[20];
+  uniform float uShowSnake; // 0 when the snake is drawn interpolated
+  varying vec2 vCell;
+
+  // Branchless on purpose: discard and per-pixel branches are many times
+  // slower than the lookup itself on software rasterizers like llvmpipe
+  void main() {
+    vec2 cell = uWrap ? mod(vCell, uBoardSize) : vCell;
+    vec2 inside = step(vec2(0.0), cell) * (1.0 - step(uBoardSize, cell));
+    vec4 texel = texture2D(uBoard, (floor(cell) + 0.5) / uBoardSize);
+    float fruit = step(2.5, texel.r * 255.0); // CELL_FRUIT
+    float occupied = step(0.5 / 255.0, texel.r) * inside.x * inside.y * max(fruit, uShowSnake);
+  #ifdef SPRITES
+    // Fragment shaders may only index uniform arrays with loop indices
+    float sprite = floor(texel.a * 255.0 + 0.5);
+    vec4 rect = uSpriteRects[0];
+    for (int i = 1; i < 20; ++i)
+      rect = mix(rect, uSpriteRects[i], float(float(i) == sprite));
+    vec2 uv = fract(cell);
+    gl_FragColor = texture2D(uAtlas, vec2(mix(rect.x, rect.z, uv.x), mix(rect.w, rect.y, uv.y))) * vec4(1.0, 1.0, 1.0, occupied);
+  #else
+    gl_FragColor = vec4(1.0, 1.0, 1.0 - fruit, occupied);
+  #endif
+  }
+)";
+
 GLuint compileShader(GLenum type, const char *source)
 {
   GLuint shader = glCreateShader(type);
@@ -162,10 +206,10 @@ GLuint compileShader(GLenum type, const char *source)
   return shader;
 }
 
-GLuint createProgram()
+GLuint createProgram(const char *vertexSource = vertexShaderSource, const char *fragmentSource = fragmentShaderSource)
 {
-  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-  GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+  GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
 
   GLuint program = glCreateProgram();
   glAttachShader(program, vertexShader);
@@ -188,36 +232,25 @@ GLuint createProgram()
   return program;
 }
 
-void drawSquare(GLuint program, float x, float y, float size, float r, float g, float b)
+// Mesa's llvmpipe and softpipe, and SwiftShader, shade on the CPU
+bool softwareRenderer()
 {
-  float vertices[] = {
-      x - size / 2, y - size / 2,
-      x + size / 2, y - size / 2,
-      x + size / 2, y + size / 2,
-      x - size / 2, y + size / 2};
-
-  GLuint vbo;
-  glGenBuffers(1, &vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  glUseProgram(program);
-
-  GLint posLoc = glGetAttribLocation(program, "aPosition");
-  glEnableVertexAttribArray(posLoc);
-  glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-  GLint colorLoc = glGetUniformLocation(program, "uColor");
-  glUniform3f(colorLoc, r, g, b);
-
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-  glDisableVertexAttribArray(posLoc);
-  glDeleteBuffers(1, &vbo);
+  const char *renderer = (const char *)glGetString(GL_RENDERER);
+  if (!renderer)
+    return false;
+  string name = renderer;
+  return name.find("llvmpipe") != string::npos || name.find("softpipe") != string::npos || name.find("SwiftShader") != string::npos;
 }
 
 GLuint loadTexture(const char *filePath)
 {
+  // A precooked .tex next to the image (make textures) skips decoding, if it
+  // was cooked from the image as it is now. The game blends straight alpha,
+  // so a premultiplied one is not used.
+  GLuint cooked = loadCookedTexture(cookedTexturePath(filePath), filePath, true);
+  if (cooked)
+    return cooked;
+
   // Load texture using an image loading library (e.g., stb_image)
   int width, height, channels;
   unsigned char *image = stbi_load(filePath, &width, &height, &channels, 4);
@@ -238,117 +271,686 @@ GLuint loadTexture(const char *filePath)
   return texture;
 }
 
-void renderText(GLuint program, GLuint texture, const string &text, float x, float y, float scale, float r, float g, float b)
+// GLUT callbacks
+GLuint program;
+GLint posLoc, texLoc, colorLoc, useTextureLoc, transformLoc;
+GLuint atlasTexture;
+
+// Text meshes, the static ones are built once and the score only when it changes
+TextMesh scoreText;
+TextMesh gameOverText;
+TextMesh gameOverScoreText;
+TextMesh restartText;
+
+// The board is drawn from a cell-state texture on GPUs. Software renderers
+// (and --quads), or boards beyond the texture size limit, keep the snake in
+// a chunked board and the fruit in a one-quad buffer instead. Both are
+// patched from the per-tick delta and work in cell units, the camera maps
+// them to the screen.
+Camera camera;
+bool useBoardTexture = true;
+bool forceQuads = false, forceTexture = false; // --quads, --texture
+bool boardSprites = false; // --sprites, snake-graphics tiles from the atlas
+BoardTexture boardTexture;
+GLuint boardProgram;
+ChunkedBoard board;
+QuadRing fruitBuffer;
+
+Quad cellQuad(const Cell &cell)
 {
-  glUseProgram(program);
-  glBindTexture(GL_TEXTURE_2D, texture);
+  return makeQuad(cell.x, cell.y, 1.0f, 1.0f);
+}
 
-  float charWidth = 1.0f / 16.0f; // Assuming 16x16 grid of characters
-  float charHeight = 1.0f / 16.0f;
+void syncBuffers()
+{
+  if (useBoardTexture)
+  {
+    boardTexture.sync(game, sim.latest().sprites);
+    clearDelta(game);
+    return;
+  }
 
-  for (char c : text)
+  if (game.delta.reset)
+  {
+    board.clear();
+    for (const auto &segment : game.snakeBody)
+      board.add(segment);
+  }
+  else
   {
-    int charIndex = c - 32; // Assuming the texture starts with ASCII 32 (space)
-    int col = charIndex % 16;
-    int row = charIndex / 16;
+    for (const auto &entry : game.delta.ops)
+    {
+      if (entry.op == POP_TAIL)
+        board.remove(entry.cell);
+      else
+        board.add(entry.cell);
+    }
+  }
 
-    float tx1 = col * charWidth;
-    float ty1 = row * charHeight;
-    float tx2 = tx1 + charWidth;
-    float ty2 = ty1 + charHeight;
+  if (game.delta.reset || game.delta.fruitMoved)
+  {
+    if (fruitBuffer.size() == 0)
+      fruitBuffer.upload({cellQuad(game.fruit)});
+    else
+      fruitBuffer.replace(0, cellQuad(game.fruit));
+  }
 
-    float vertices[] = {
-        x, y, tx1, ty1,
-        x + scale, y, tx2, ty1,
-        x + scale, y + scale, tx2, ty2,
-        x, y + scale, tx1, ty2};
+  clearDelta(game);
+}
 
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+int statsFrames = 0;
+size_t statsBytes = 0;
+std::chrono::steady_clock::time_point statsStart = std::chrono::steady_clock::now();
 
-    GLint posLoc = glGetAttribLocation(program, "aPosition");
-    GLint texLoc = glGetAttribLocation(program, "aTexCoord");
+void reportFrameStats()
+{
+  statsFrames++;
+  statsBytes += uploadStats.frameBytes;
+  auto now = std::chrono::steady_clock::now();
+  if (printStats && now - statsStart >= std::chrono::seconds(1))
+  {
+    cout << "frames: " << statsFrames << " upload: " << statsBytes / statsFrames << " bytes/frame (last " << uploadStats.frameBytes << ", full uploads " << uploadStats.fullUploads
+         << ") chunks: " << board.drawnChunks << " drawn, " << board.patchedChunks << " patched, " << board.rebuiltChunks << " rebuilt" << endl;
+    statsFrames = 0;
+    statsBytes = 0;
+    statsStart = now;
+  }
+  uploadStats.frameBytes = 0;
+  board.drawnChunks = 0;
+  board.rebuiltChunks = 0;
+  board.patchedChunks = 0;
+}
 
-    glEnableVertexAttribArray(posLoc);
-    glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(texLoc);
-    glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
+// Draws the fruit into every visible copy of the wrapping board
+void drawFruit()
+{
+  float transform[4];
+  for (const Cell &copy : visibleBoardCopies(camera, game.columns, game.rows))
+  {
+    camera.transform(copy.x, copy.y, transform);
+    glUniform4fv(transformLoc, 1, transform);
+    fruitBuffer.draw(posLoc, -1);
+  }
+  glUniform4f(transformLoc, 1.0f, 1.0f, 0.0f, 0.0f);
+}
 
-    GLint colorLoc = glGetUniformLocation(program, "uColor");
-    glUniform3f(colorLoc, r, g, b);
+// Bursts for the fruit-eaten and game-over events, drawn over the board in
+// one batch per visible board copy
+ParticleSystem particles;
+GLuint particleProgram;
+GLint particleTransformLoc, particlePointSizeLoc;
+std::chrono::steady_clock::time_point lastParticleUpdate = std::chrono::steady_clock::now();
 
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+void spawnEffects()
+{
+  for (const auto &entry : game.delta.events)
+    particles.spawn(entry.cell.x + 0.5f, entry.cell.y + 0.5f, entry.event == EVENT_FRUIT_EATEN ? fruitEatenBurst : gameOverBurst);
+}
 
-    glDisableVertexAttribArray(posLoc);
-    glDisableVertexAttribArray(texLoc);
-    glDeleteBuffers(1, &vbo);
+void drawParticles()
+{
+  // Headless frames are evenly spaced on the simulated clock
+  auto now = std::chrono::steady_clock::now();
+  float dt = headless ? 1.0f / renderRate() : min(std::chrono::duration<float>(now - lastParticleUpdate).count(), 0.1f);
+  lastParticleUpdate = now;
+  if (particles.size() == 0)
+    return;
+  particles.update(dt);
+  particles.upload();
 
-    x += scale; // Move to next character position
+  glUseProgram(particleProgram);
+  glUniform1f(particlePointSizeLoc, viewportWidth / camera.viewColumns * 0.3f);
+  float transform[4];
+  for (const Cell &copy : visibleBoardCopies(camera, game.columns, game.rows))
+  {
+    camera.transform(copy.x, copy.y, transform);
+    glUniform4fv(particleTransformLoc, 1, transform);
+    particles.draw();
   }
+  glUseProgram(program);
 }
 
-// GLUT callbacks
-GLuint program;
+// The snake between its last two cells, with its tiles in sprite mode
+void drawSmoothSnake(float alpha)
+{
+  static const vector<unsigned char> flat;
+  const FrameSnapshot &snapshot = sim.latest();
+  smoothSnake.build(game, snapshot.previousBody, boardSprites ? snapshot.sprites : flat, alpha, camera);
+  glUniform3f(colorLoc, 1.0f, 1.0f, 1.0f);
+  if (boardSprites)
+  {
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glUniform1i(useTextureLoc, 1);
+  }
+  smoothSnake.draw(game, camera, posLoc, boardSprites ? texLoc : -1, transformLoc);
+  glUniform1i(useTextureLoc, 0);
+}
+
+void drawText(TextMesh &mesh, float r, float g, float b)
+{
+  glBindTexture(GL_TEXTURE_2D, atlasTexture);
+  glUniform1i(useTextureLoc, 1);
+  glUniform3f(colorLoc, r, g, b);
+  mesh.draw(posLoc, texLoc);
+  glUniform1i(useTextureLoc, 0);
+}
+
+void drawGameover()
+{
+  gameOverScoreText.build("SCORE:" + to_string(game.playerScore), 0.0f, 0.58f, 0.1f, true);
+  drawText(gameOverText, 1.0f, 1.0f, 1.0f);
+  drawText(gameOverScoreText, 1.0f, 1.0f, 1.0f);
+  drawText(restartText, 1.0f, 1.0f, 1.0f);
+}
+
+// Reads the back buffer straight into a capture buffer before it is swapped.
+// Realtime play drops the frame when the writer is behind, headless runs are
+// offline and wait for it instead. Frames of a window that has not yet been
+// sized back to the capture's size are dropped too.
+void captureGLFrame()
+{
+  if (viewportWidth != windowWidth || viewportHeight != windowHeight)
+  {
+    frameCapture.droppedFrames++;
+    return;
+  }
+  unsigned char *pixels = frameCapture.acquireFrame(headless);
+  if (!pixels)
+    return;
+  glReadPixels(0, 0, windowWidth, windowHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  frameCapture.submitFrame();
+}
+
+void stopCapture()
+{
+  if (!frameCapture.isActive())
+    return;
+  frameCapture.stop();
+  cout << "capture: " << frameCapture.capturedFrames << " captured, " << frameCapture.writtenFrames << " written, " << frameCapture.droppedFrames << " dropped, " << frameCapture.failedFrames << " failed" << endl;
+  if (frameCapture.closeFailed)
+    cerr << "Could not finish writing " << frameCapture.outputPath() << endl;
+}
+
+// Samples the frame that ends here and draws the overlay over it. The
+// counters restart after the overlay, so its own draws and allocations
+// never show up in what it or the frame log report.
+void drawHud()
+{
+  if (glFrameLog.isActive())
+    glFrameLog.frameDone(glCounters);
+  if (hud.visible)
+  {
+    uint64_t allocations = heapAllocations.load(memory_order_relaxed);
+    hud.frame({glCounters, allocations - frameStartAllocations, wallBoards > 0 ? wall.latest().sequence : sim.ticks.load(memory_order_relaxed)});
+    glUseProgram(program);
+    glUniform4f(transformLoc, 1.0f, 1.0f, 0.0f, 0.0f);
+    hud.draw(posLoc, texLoc, colorLoc, useTextureLoc, atlasTexture);
+  }
+  glCounters = GLCounters();
+  frameStartAllocations = heapAllocations.load(memory_order_relaxed);
+}
+
+void armTimer();
+
+void displayWall()
+{
+  PROFILE_SCOPE("display");
+  glClear(GL_COLOR_BUFFER_BIT);
+  if (wall.readLatest())
+    boardWall.upload(wall.latest());
+  glUseProgram(wallProgram);
+  boardWall.draw((float)viewportWidth / viewportHeight);
+  drawHud();
+
+  if (frameCapture.isActive())
+    captureGLFrame();
+  swapBuffers();
+  reportFrameStats();
+  frameDirty = false;
+  armTimer();
+}
 
 void display()
 {
+  if (wallBoards > 0)
+  {
+    displayWall();
+    return;
+  }
+  PROFILE_SCOPE("display");
   glClear(GL_COLOR_BUFFER_BIT);
 
-  drawSquare(program, fruitX, fruitY, snakeWidth, 1.0f, 1.0f, 0.0f);
-  for (const auto &segment : snakeBody)
+  sim.readLatest(game);
+  spawnEffects();
+  syncBuffers();
+
+  glUseProgram(program);
+  if (game.isGameOver)
+  {
+    drawParticles();
+    drawGameover();
+  }
+  else
   {
-    drawSquare(program, segment.x, segment.y, snakeWidth, 1.0f, 1.0f, 1.0f);
+    float alpha = smoothMotion ? tickAlpha() : 1.0f;
+    if (smoothMotion)
+    {
+      const vector<Cell> &previousBody = sim.latest().previousBody;
+      float headX, headY;
+      interpolateSegment(game, previousBody.empty() ? game.snakeBody[0] : previousBody[0], game.snakeBody[0], alpha, headX, headY);
+      camera.follow(game, headX, headY);
+    }
+    else
+    {
+      camera.follow(game);
+    }
+
+    if (useBoardTexture)
+    {
+      glUseProgram(boardProgram);
+      boardTexture.draw(camera);
+      glUseProgram(program);
+    }
+    else
+    {
+      glUniform3f(colorLoc, 1.0f, 1.0f, 0.0f);
+      drawFruit();
+      glUniform3f(colorLoc, 1.0f, 1.0f, 1.0f);
+      if (!smoothMotion)
+        board.draw(camera, posLoc, transformLoc);
+    }
+    if (smoothMotion)
+      drawSmoothSnake(alpha);
+    drawParticles();
+
+    scoreText.build("SCORE:" + to_string(game.playerScore), -0.9f, 0.85f, 0.07f);
+    drawText(scoreText, 1.0f, 1.0f, 1.0f);
   }
+  drawHud();
+
+  if (frameCapture.isActive())
+    captureGLFrame();
+  swapBuffers();
+  reportFrameStats();
+  frameDirty = false;
+  armTimer();
+}
+
+// The simulation ticks on its own thread, this timer only polls for new
+// snapshots (and paces interpolated frames). It is armed while the snake
+// moves (or a capture needs a steady frame rate) and after input until a
+// snapshot that took the input has been drawn, so a paused or finished game
+// blocks in glutMainLoop instead of waking up every frame.
+bool timerArmed = false;
 
-  glutSwapBuffers();
+void update(int);
+
+bool isSimulating()
+{
+  return wallBoards > 0 || (game.snakeDirection != NONE && !game.isGameOver) || frameCapture.isActive() || particles.size() > 0;
 }
 
-void keyboard(int key, int, int)
+void armTimer()
 {
-  if (key == GLUT_KEY_LEFT && snakeDirection != RIGHT)
-    snakeDirection = LEFT;
-  if (key == GLUT_KEY_RIGHT && snakeDirection != LEFT)
-    snakeDirection = RIGHT;
-  if (key == GLUT_KEY_UP && snakeDirection != DOWN)
-    snakeDirection = UP;
-  if (key == GLUT_KEY_DOWN && snakeDirection != UP)
-    snakeDirection = DOWN;
+  if (timerArmed || headless || !(isSimulating() || (wallBoards == 0 && sim.awaitsInput())))
+    return;
+  timerArmed = true;
+  glutTimerFunc(1000 / renderRate(), update, 0);
 }
 
-std::chrono::steady_clock::time_point lastMoveTime = std::chrono::steady_clock::now();
-const std::chrono::milliseconds moveInterval((int)(100 / (0.1f * snakeSpeed)));
+void markDirty()
+{
+  if (!frameDirty && !headless)
+    glutPostRedisplay();
+  frameDirty = true;
+}
+
+void keyboard(unsigned char key, int, int)
+{
+  if ((key == 'p' || key == 'P') && !profilePath.empty())
+    profiler.writeTo(profilePath);
+  if (key == 'h' || key == 'H')
+  {
+    hud.visible = !hud.visible;
+    hud.restart();
+    markDirty();
+  }
+  if (key != ' ')
+    return;
+  sim.send(COMMAND_SPACE, inputTime());
+  armTimer();
+}
+
+void specialKeyboard(int key, int, int)
+{
+  if (key == GLUT_KEY_LEFT)
+    sim.send(COMMAND_LEFT, inputTime());
+  else if (key == GLUT_KEY_RIGHT)
+    sim.send(COMMAND_RIGHT, inputTime());
+  else if (key == GLUT_KEY_UP)
+    sim.send(COMMAND_UP, inputTime());
+  else if (key == GLUT_KEY_DOWN)
+    sim.send(COMMAND_DOWN, inputTime());
+  else
+    return;
+  armTimer();
+}
+
+// Captures keep the size they started with, so the window is sized back
+// while one is running
+void reshape(int width, int height)
+{
+  if (frameCapture.isActive() && (width != windowWidth || height != windowHeight))
+    glutReshapeWindow(windowWidth, windowHeight);
+  viewportWidth = width;
+  viewportHeight = max(height, 1);
+  glViewport(0, 0, width, height);
+  markDirty();
+}
 
 void update(int)
 {
-  auto currentTime = std::chrono::steady_clock::now();
-  bool movementIntervalMet = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastMoveTime) >= moveInterval;
-  if (movementIntervalMet)
+  timerArmed = false;
+  if (sim.hasFreshSnapshot() || wall.hasFreshSnapshot() || frameCapture.isActive() || particles.size() > 0 || (smoothMotion && isSimulating()))
+    markDirty();
+  armTimer();
+}
+
+// Headless runs advance on a simulated clock and steer with the autopilot
+// through the same key handlers a player would use
+void headlessStep(int frame)
+{
+  if (wallBoards > 0)
+  {
+    const int frameMs = 1000 / renderRate();
+    if ((frame * frameMs) / moveInterval.count() != ((frame + 1) * frameMs) / moveInterval.count())
+      wall.step();
+    return;
+  }
+
+  if (sim.game.isGameOver)
   {
-    moveSnake();
-    checkCollisions();
-    lastMoveTime = currentTime;
+    keyboard(' ', 0, 0);
+    sim.step(false);
+    return;
+  }
+
+  const int frameMs = 1000 / renderRate();
+  const int tickMs = moveInterval.count();
+  if ((frame * frameMs) / tickMs == ((frame + 1) * frameMs) / tickMs)
+  {
+    simulatedNow = std::chrono::steady_clock::time_point(std::chrono::milliseconds((frame + 1) * frameMs));
+    return;
+  }
+
+  // The autopilot presses at the start of the frame, the tick lands within it
+  simulatedNow = std::chrono::steady_clock::time_point(std::chrono::milliseconds(frame * frameMs));
+  switch (steerTowardsFruit(sim.game))
+  {
+  case LEFT:
+    specialKeyboard(GLUT_KEY_LEFT, 0, 0);
+    break;
+  case RIGHT:
+    specialKeyboard(GLUT_KEY_RIGHT, 0, 0);
+    break;
+  case UP:
+    specialKeyboard(GLUT_KEY_UP, 0, 0);
+    break;
+  case DOWN:
+    specialKeyboard(GLUT_KEY_DOWN, 0, 0);
+    break;
+  default:
+    break;
   }
-  glutPostRedisplay();
-  glutTimerFunc(1000 / frame_rate, update, 0);
+  simulatedNow = std::chrono::steady_clock::time_point(std::chrono::milliseconds((frame + 1) * frameMs));
+  sim.step(true, std::chrono::steady_clock::time_point(std::chrono::milliseconds((frame + 1) * frameMs / tickMs * tickMs)));
+}
+
+// freeglut leaves the main loop through exit(). The simulation threads use
+// globals, so they stop before any of those are destroyed.
+void stopSimulation()
+{
+  sim.stop();
+  wall.stop();
+}
+
+// Saves the game in progress for --record, once the simulation has stopped
+void saveRecording()
+{
+  sim.stop();
+  if (!sim.saveRecording())
+    cerr << "Could not write " << recordPath << endl;
+}
+
+// Input latency report for --stats, once the simulation has stopped
+void printInputStats()
+{
+  sim.stop();
+  sim.turnLatency.print(cout, "turn latency");
+  cout << "turns ignored (no change or reversal): " << sim.droppedTurns << endl;
+}
+
+// Whole-string positive int for counts given on the command line; atoi()
+// would read "abc" as 0 and "4x" as 4
+bool parsePositive(const char *text, int &value)
+{
+  char *end;
+  errno = 0;
+  long parsed = strtol(text, &end, 10);
+  if (end == text || *end != '\0' || errno == ERANGE || parsed < 1 || parsed > INT_MAX)
+    return false;
+  value = (int)parsed;
+  return true;
 }
 
 int main(int argc, char **argv)
 {
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-  glutInitWindowSize(800, 800);
-  glutCreateWindow("Snake Game");
+  HeadlessOptions headlessOptions = parseHeadlessArgs(argc, argv);
+  string capturePath;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (string(argv[i]) == "--stats")
+      printStats = true;
+    if (string(argv[i]) == "--capture" && i + 1 < argc)
+      capturePath = argv[++i];
+    if (string(argv[i]) == "--record" && i + 1 < argc)
+      recordPath = argv[++i];
+    if (string(argv[i]) == "--profile" && i + 1 < argc)
+      profilePath = argv[++i];
+    if (string(argv[i]) == "--hud")
+      hud.visible = true;
+    if (string(argv[i]) == "--gl-csv" && i + 1 < argc && !glFrameLog.openCsv(argv[++i]))
+    {
+      cerr << "Could not open " << argv[i] << endl;
+      return 1;
+    }
+    if (string(argv[i]) == "--gl-budget" && i + 1 < argc && !glFrameLog.parseBudget(argv[++i]))
+    {
+      cerr << "Unknown counter or bad limit in --gl-budget " << argv[i] << endl;
+      return 1;
+    }
+    if (string(argv[i]) == "--quads")
+      forceQuads = true;
+    if (string(argv[i]) == "--texture")
+      forceTexture = true;
+    if (string(argv[i]) == "--sprites")
+      boardSprites = true;
+    if (string(argv[i]) == "--smooth")
+    {
+      smoothMotion = true;
+      if (i + 1 < argc && atoi(argv[i + 1]) > 0)
+        refreshRate = atoi(argv[++i]);
+    }
+    if (string(argv[i]) == "--wall" && i + 1 < argc && !parsePositive(argv[++i], wallBoards))
+    {
+      cerr << "--wall needs a positive number of boards, not " << argv[i] << endl;
+      return 1;
+    }
+    if (string(argv[i]) == "--board" && i + 2 < argc)
+    {
+      if (!parsePositive(argv[i + 1], columns) || !parsePositive(argv[i + 2], rows))
+      {
+        cerr << "--board needs a positive width and height, not " << argv[i + 1] << " " << argv[i + 2] << endl;
+        return 1;
+      }
+      i += 2;
+    }
+  }
+
+  if (!profilePath.empty())
+  {
+    profiler.enable();
+    profiler.nameThread("main");
+  }
+
+  if (headless)
+  {
+    if (!createHeadlessContext(windowWidth, windowHeight, false))
+      return 1;
+  }
+  else
+  {
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+    glutInitWindowSize(windowWidth, windowHeight);
+    glutCreateWindow("Snake Game");
+  }
+
+  if (!capturePath.empty())
+  {
+    if (!frameCapture.start(capturePath, windowWidth, windowHeight, renderRate(), true))
+    {
+      cerr << "Could not open " << capturePath << endl;
+      return 1;
+    }
+    // freeglut leaves the main loop through exit()
+    atexit(stopCapture);
+  }
 
   program = createProgram();
-  placeFruit();
-  snakeWidth = 2.0f / columns;
-  snakeHeight = 2.0f / rows;
+  posLoc = glGetAttribLocation(program, "aPosition");
+  texLoc = glGetAttribLocation(program, "aTexCoord");
+  colorLoc = glGetUniformLocation(program, "uColor");
+  useTextureLoc = glGetUniformLocation(program, "uUseTexture");
+  transformLoc = glGetUniformLocation(program, "uTransform");
+  glUseProgram(program);
+  glUniform4f(transformLoc, 1.0f, 1.0f, 0.0f, 0.0f);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  particleProgram = createProgram(particleVertexShaderSource, particleFragmentShaderSource);
+  particleTransformLoc = glGetUniformLocation(particleProgram, "uTransform");
+  particlePointSizeLoc = glGetUniformLocation(particleProgram, "uPointSize");
+  particles.init(8192);
+  particles.bind(particleProgram);
+
+  atlasTexture = loadTexture(atlasTexturePath);
+  if (boardSprites)
+  {
+    // Cells cut tiles out of the atlas, mips would blur across the cell edges
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  }
+  for (TextMesh *text : {&scoreText, &gameOverText, &gameOverScoreText, &restartText})
+    text->init();
+  gameOverText.build("GAME OVER!", 0.0f, 0.7f, 0.13f, true);
+  restartText.build("\"SPACE\" TO RESTART", 0.0f, 0.48f, 0.08f, true);
+
+  game.columns = sim.game.columns = columns;
+  game.rows = sim.game.rows = rows;
+  if (!recordPath.empty())
+    sim.record(recordPath, moveInterval);
+  sim.newGame(headless ? 1 : random_device()());
+  sim.publish();
+  if (wallBoards > 0)
+  {
+    wall.init(wallBoards, columns, rows, headless ? 1 : random_device()());
+    if (!BoardWall::fits(wall, columns, rows))
+    {
+      cerr << wallBoards << " boards of " << columns << "x" << rows << " are beyond the texture size limit" << endl;
+      return 1;
+    }
+    wallProgram = createProgram(wallVertexShaderSource, wallFragmentShaderSource);
+    boardWall.bind(wallProgram);
+    glUseProgram(wallProgram);
+    glUniform1i(glGetUniformLocation(wallProgram, "uCells"), 0);
+    glUniform1i(glGetUniformLocation(wallProgram, "uTints"), 1);
+    glUseProgram(program);
+    boardWall.init(wall.size(), wall.wallColumns(), wall.wallRows(), columns, rows);
+    wall.publish();
+  }
+  // The texture path is fill bound where fragments are shaded on the CPU:
+  // 172 fps at 800x800 on llvmpipe against about 1000 with quads. Quads
+  // cannot draw the sprite tiles, so --sprites keeps the texture unless
+  // --smooth draws the snake.
+  useBoardTexture = !forceQuads && (forceTexture || (boardSprites && !smoothMotion) || !softwareRenderer());
+  if (useBoardTexture && !BoardTexture::fits(columns, rows))
+  {
+    cerr << columns << "x" << rows << " is beyond the texture size limit, drawing the board with quads" << endl;
+    useBoardTexture = false;
+  }
+  if (useBoardTexture)
+  {
+    string fragmentSource = string(boardSprites ? "#define SPRITES\n" : "") + boardFragmentShaderSource;
+    boardProgram = createProgram(boardVertexShaderSource, fragmentSource.c_str());
+    boardTexture.bind(boardProgram);
+    glUseProgram(boardProgram);
+    glUniform1i(glGetUniformLocation(boardProgram, "uBoard"), 0);
+    glUniform1i(glGetUniformLocation(boardProgram, "uAtlas"), 1);
+    glUniform4fv(glGetUniformLocation(boardProgram, "uSpriteRects"), snakeColumns * snakeRows, &snakeRects[0].u1);
+    glUniform1f(glGetUniformLocation(boardProgram, "uShowSnake"), smoothMotion ? 0.0f : 1.0f);
+    glUseProgram(program);
+    if (boardSprites)
+    {
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, atlasTexture);
+      glActiveTexture(GL_TEXTURE0);
+    }
+    boardTexture.init(columns, rows);
+  }
+  else
+  {
+    board.init(columns, rows);
+    fruitBuffer.init(1);
+  }
+
+  if (headless)
+  {
+    runHeadless(headlessOptions, headlessStep, display);
+    stopCapture();
+    cout << "upload: " << uploadStats.totalBytes / max(headlessOptions.frames, 1) << " bytes/frame, " << uploadStats.fullUploads << " full uploads, score " << game.playerScore
+         << " (" << columns << "x" << rows << " board)" << endl;
+    if (printStats && wallBoards == 0)
+      printInputStats();
+    if (!recordPath.empty())
+      saveRecording();
+    if (!profilePath.empty())
+      profiler.writeTo(profilePath);
+    if (wallBoards > 0)
+      cout << "wall: " << wall.size() << " boards, " << wall.latest().finishedGames << " games finished, best score " << wall.latest().bestScore << endl;
+    glFrameLog.close();
+    if (glFrameLog.overBudgetFrames > 0)
+      cerr << "GL budget: " << glFrameLog.overBudgetFrames << " frames over budget" << endl;
+    destroyHeadlessContext();
+    return glFrameLog.overBudgetFrames > 0 || frameCapture.failedFrames > 0 || frameCapture.closeFailed ? 1 : 0;
+  }
 
   glutDisplayFunc(display);
-  glutSpecialFunc(keyboard);
-  glutTimerFunc(1000 / frame_rate, update, 0);
+  glutKeyboardFunc(keyboard);
+  glutSpecialFunc(specialKeyboard);
+  glutReshapeFunc(reshape);
+  if (wallBoards > 0)
+    wall.start(moveInterval);
+  else
+    sim.start(moveInterval);
+  if (printStats && wallBoards == 0)
+    atexit(printInputStats);
+  if (!recordPath.empty())
+    atexit(saveRecording);
+  if (!profilePath.empty())
+    atexit([] { profiler.writeTo(profilePath); });
+  // Registered last, so it runs first
+  atexit(stopSimulation);
 
   glutMainLoop();
   return 0;
@@ -0,0 +1,123 @@
+// Measures texture startup cost: decoding a PNG with stb_image and building
+// mips on the GPU against mapping a precooked .tex and uploading it as is.
+// Cold runs evict the file from the page cache before every load, warm runs
+// read it from memory. Runs offscreen through EGL.
+//
+//   texture_bench [IMAGE.png] [--iterations N]
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GL/glut.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "platform/headless.cpp"
+#include "render/cooked_texture.cpp"
+
+using namespace std;
+using namespace chrono;
+
+GLuint loadStbTexture(const string &path)
+{
+  int width, height, channels;
+  unsigned char *image = stbi_load(path.c_str(), &width, &height, &channels, 4);
+  if (!image)
+    return 0;
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  stbi_image_free(image);
+  return texture;
+}
+
+// Drops the file's pages from the page cache, which needs no privileges
+void evictFromPageCache(const string &path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// Median milliseconds from starting the load to the texture being resident
+double measure(GLuint (*load)(const string &), const string &path, int iterations, bool cold)
+{
+  vector<double> times;
+  for (int i = 0; i < iterations; ++i)
+  {
+    if (cold)
+      evictFromPageCache(path);
+    auto start = steady_clock::now();
+    GLuint texture = load(path);
+    glFinish();
+    times.push_back(duration<double, milli>(steady_clock::now() - start).count());
+    if (!texture)
+    {
+      cerr << "Failed to load " << path << endl;
+      exit(1);
+    }
+    glDeleteTextures(1, &texture);
+  }
+  sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+// Checked against the image, like the games do
+string sourceImagePath;
+
+GLuint loadCooked(const string &path)
+{
+  return loadCookedTexture(path, sourceImagePath);
+}
+
+int main(int argc, char **argv)
+{
+  string imagePath = "web/res/atlas.png";
+  int iterations = 50;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc)
+      iterations = max(atoi(argv[++i]), 1);
+    else
+      imagePath = arg;
+  }
+  string cookedPath = cookedTexturePath(imagePath);
+  sourceImagePath = imagePath;
+
+  if (!createHeadlessContext(64, 64, false))
+    return 1;
+
+  // The first upload pays for driver start up, keep it out of the numbers
+  GLuint warmup = loadStbTexture(imagePath);
+  if (!warmup)
+  {
+    cerr << "Failed to load " << imagePath << endl;
+    return 1;
+  }
+  glDeleteTextures(1, &warmup);
+
+  cout << "median of " << iterations << " loads, ms" << endl;
+  cout << "                 cold     warm" << endl;
+  for (int cooked = 0; cooked < 2; ++cooked)
+  {
+    const string &path = cooked ? cookedPath : imagePath;
+    GLuint (*load)(const string &) = cooked ? loadCooked : loadStbTexture;
+    double cold = measure(load, path, iterations, true);
+    double warm = measure(load, path, iterations, false);
+    printf("%-14s %8.3f %8.3f  %s\n", cooked ? "mmap .tex" : "stb_image", cold, warm, path.c_str());
+  }
+
+  destroyHeadlessContext();
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Converts images into precooked .tex textures: RGBA8 with the full mip
+// chain already built, so the game maps the file and uploads it without
+// decoding a PNG or generating mips at startup.
+//
+//   texture_cooker IN.png OUT.tex [--premultiply] [--no-mips]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include "utils/texture_file.cpp"
+
+using namespace std;
+
+struct MipLevel
+{
+  int width, height;
+  vector<unsigned char> pixels;
+};
+
+void premultiply(vector<unsigned char> &pixels)
+{
+  for (size_t i = 0; i < pixels.size(); i += 4)
+    for (int c = 0; c < 3; ++c)
+      pixels[i + c] = (pixels[i + c] * pixels[i + 3] + 127) / 255;
+}
+
+// 2x2 box filter weighted by alpha, so fully transparent texels do not
+// bleed their (meaningless) colour into the smaller levels
+MipLevel downsample(const MipLevel &source, bool premultiplied)
+{
+  MipLevel level;
+  level.width = max(source.width / 2, 1);
+  level.height = max(source.height / 2, 1);
+  level.pixels.resize((size_t)level.width * level.height * 4);
+  for (int y = 0; y < level.height; ++y)
+  {
+    for (int x = 0; x < level.width; ++x)
+    {
+      unsigned colour[3] = {0, 0, 0}, alpha = 0, samples = 0;
+      for (int dy = 0; dy < 2; ++dy)
+      {
+        for (int dx = 0; dx < 2; ++dx)
+        {
+          int sx = min(x * 2 + dx, source.width - 1);
+          int sy = min(y * 2 + dy, source.height - 1);
+          const unsigned char *px = &source.pixels[((size_t)sy * source.width + sx) * 4];
+          unsigned weight = premultiplied ? 255 : px[3];
+          for (int c = 0; c < 3; ++c)
+            colour[c] += px[c] * weight;
+          alpha += px[3];
+          samples++;
+        }
+      }
+      unsigned char *out = &level.pixels[((size_t)y * level.width + x) * 4];
+      unsigned totalWeight = premultiplied ? 255 * samples : alpha;
+      for (int c = 0; c < 3; ++c)
+        out[c] = totalWeight ? (colour[c] + totalWeight / 2) / totalWeight : 0;
+      out[3] = (alpha + samples / 2) / samples;
+    }
+  }
+  return level;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    cerr << "usage: texture_cooker IN.png OUT.tex [--premultiply] [--no-mips]" << endl;
+    return 1;
+  }
+  string inputPath = argv[1];
+  string outputPath = argv[2];
+  bool premultiplied = false;
+  bool mips = true;
+  for (int i = 3; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--premultiply")
+      premultiplied = true;
+    else if (arg == "--no-mips")
+      mips = false;
+  }
+
+  uint64_t sourceSize, sourceMtime, sourceHash;
+  if (!statSourceFile(inputPath, sourceSize, sourceMtime) || !hashSourceFile(inputPath, sourceSize, sourceHash))
+  {
+    cerr << "Failed to load " << inputPath << endl;
+    return 1;
+  }
+  int width, height, channels;
+  unsigned char *image = stbi_load(inputPath.c_str(), &width, &height, &channels, 4);
+  if (!image)
+  {
+    cerr << "Failed to load " << inputPath << endl;
+    return 1;
+  }
+
+  // GLES2 only mipmaps power of two textures
+  bool powerOfTwo = (width & (width - 1)) == 0 && (height & (height - 1)) == 0;
+  if (mips && !powerOfTwo)
+  {
+    cerr << inputPath << ": " << width << "x" << height << " is not a power of two, cooking without mips" << endl;
+    mips = false;
+  }
+
+  vector<MipLevel> levels(1);
+  levels[0].width = width;
+  levels[0].height = height;
+  levels[0].pixels.assign(image, image + (size_t)width * height * 4);
+  stbi_image_free(image);
+  if (premultiplied)
+    premultiply(levels[0].pixels);
+  while (mips && (levels.back().width > 1 || levels.back().height > 1) && levels.size() < maxTextureMips)
+    levels.push_back(downsample(levels.back(), premultiplied));
+
+  TextureFileHeader header;
+  memcpy(header.magic, textureFileMagic, 4);
+  header.version = textureFileVersion;
+  header.format = TEXTURE_RGBA8;
+  header.flags = premultiplied ? TEXTURE_PREMULTIPLIED : 0;
+  header.width = width;
+  header.height = height;
+  header.mipCount = levels.size();
+  header.reserved = 0;
+  header.sourceSize = sourceSize;
+  header.sourceMtime = sourceMtime;
+  header.sourceHash = sourceHash;
+
+  vector<TextureFileMip> table(levels.size());
+  uint64_t offset = sizeof(TextureFileHeader) + table.size() * sizeof(TextureFileMip);
+  for (size_t i = 0; i < levels.size(); ++i)
+  {
+    offset = (offset + 15) & ~(uint64_t)15;
+    table[i].width = levels[i].width;
+    table[i].height = levels[i].height;
+    table[i].offset = offset;
+    table[i].size = levels[i].pixels.size();
+    offset += table[i].size;
+  }
+
+  FILE *file = fopen(outputPath.c_str(), "wb");
+  if (!file)
+  {
+    cerr << "Could not write " << outputPath << endl;
+    return 1;
+  }
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(table.data(), sizeof(TextureFileMip), table.size(), file);
+  for (size_t i = 0; i < levels.size(); ++i)
+  {
+    static const unsigned char zeros[16] = {};
+    fwrite(zeros, 1, table[i].offset - ftell(file), file);
+    fwrite(levels[i].pixels.data(), 1, levels[i].pixels.size(), file);
+  }
+  fclose(file);
+
+  cout << outputPath << ": " << width << "x" << height << ", " << levels.size() << " level" << (levels.size() == 1 ? "" : "s")
+       << (premultiplied ? ", premultiplied" : "") << ", " << offset << " bytes" << endl;
+  return 0;
+}
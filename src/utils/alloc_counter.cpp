@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+// Counts heap allocations made through new, on every thread, by replacing
+// the global operator new. Include from one translation unit only.
+atomic<uint64_t> heapAllocations(0);
+
+void *operator new(size_t size)
+{
+  heapAllocations.fetch_add(1, memory_order_relaxed);
+  void *memory = malloc(size ? size : 1);
+  if (!memory)
+    throw bad_alloc();
+  return memory;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+  free(memory);
+}
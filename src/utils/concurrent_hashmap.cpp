@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "hashmap.cpp"
+
+using namespace std;
+
+// Epoch based reclamation for tables a writer has replaced. A reader
+// announces the epoch it started in and clears it when done; a writer tags
+// each replaced table with the epoch it was retired in and frees it once
+// every reader still announcing started later. One record per thread,
+// shared by every map, and reused once its thread has exited.
+struct ReaderRecord {
+  atomic<uint64_t> epoch{0}; // 0 while the thread is not reading
+  atomic<bool> owned{true};
+  ReaderRecord *next = nullptr;
+  char padding[64]; // keeps the next record's epoch off this cache line
+};
+
+class ReaderEpochs {
+  atomic<uint64_t> current{1};
+  atomic<ReaderRecord *> records{nullptr};
+
+  // Hands the record back when its thread exits
+  struct Owner {
+    ReaderRecord *record = nullptr;
+
+    ~Owner() {
+      if (record)
+        record->owned.store(false, memory_order_release);
+    }
+  };
+
+  public:
+    ~ReaderEpochs() {
+      ReaderRecord *record = records.load();
+      while (record) {
+        ReaderRecord *next = record->next;
+        delete record;
+        record = next;
+      }
+    }
+
+    ReaderRecord &threadRecord() {
+      static thread_local Owner owner;
+      if (owner.record)
+        return *owner.record;
+      for (ReaderRecord *record = records.load(memory_order_acquire); record; record = record->next) {
+        bool owned = false;
+        if (record->owned.compare_exchange_strong(owned, true, memory_order_acquire)) {
+          owner.record = record;
+          return *record;
+        }
+      }
+      owner.record = new ReaderRecord();
+      owner.record->next = records.load(memory_order_relaxed);
+      while (!records.compare_exchange_weak(owner.record->next, owner.record, memory_order_release, memory_order_relaxed))
+        ;
+      return *owner.record;
+    }
+
+    // The fence orders the announcement before the reader's loads of table
+    // pointers, pairing with the sequentially consistent publish in grow()
+    void enter(ReaderRecord &record) {
+      record.epoch.store(current.load(memory_order_seq_cst), memory_order_relaxed);
+      atomic_thread_fence(memory_order_seq_cst);
+    }
+
+    void exit(ReaderRecord &record) {
+      record.epoch.store(0, memory_order_release);
+    }
+
+    // Call after the replacement is published; returns the epoch to tag the
+    // old table with
+    uint64_t retire() {
+      return current.fetch_add(1, memory_order_seq_cst);
+    }
+
+    // Tables retired in an epoch before this are no longer being read
+    uint64_t oldestReader() const {
+      uint64_t oldest = UINT64_MAX;
+      for (ReaderRecord *record = records.load(memory_order_acquire); record; record = record->next) {
+        uint64_t epoch = record->epoch.load(memory_order_seq_cst);
+        if (epoch && epoch < oldest)
+          oldest = epoch;
+      }
+      return oldest;
+    }
+};
+
+ReaderEpochs readerEpochs;
+
+// Hashtable for many threads: keys are spread over shards, each an open
+// addressing table guarded by a seqlock. Writers to a shard serialize on
+// its mutex and bump its sequence around every change; readers take no
+// lock at all, they copy the entry out and retry if the sequence moved.
+// Entries are stored as atomic words, so keys and values have to be
+// trivially copyable (ids, handles, small structs). When tombstones from
+// erases fill a shard, it is rebuilt in place while its sequence is odd; a
+// new table is allocated only when the live entries outgrow the old one,
+// which is freed once no reader can still be probing it.
+template <typename KeyType, typename ValueType, typename Hash = typename DefaultHash<KeyType>::type>
+class ConcurrentHashtable {
+  static_assert(is_trivially_copyable<KeyType>::value && is_trivially_copyable<ValueType>::value,
+                "ConcurrentHashtable copies keys and values word by word");
+
+  static const size_t keyWords = (sizeof(KeyType) + 7) / 8;
+  static const size_t valueWords = (sizeof(ValueType) + 7) / 8;
+  static const size_t slotWords = keyWords + valueWords;
+
+  enum SlotState : uint8_t { SLOT_EMPTY, SLOT_FULL, SLOT_DELETED };
+
+  struct Table {
+    size_t capacity; // a power of two
+    unique_ptr<atomic<uint8_t>[]> states;
+    unique_ptr<atomic<uint64_t>[]> words;
+
+    explicit Table(size_t slots) : capacity(slots), states(new atomic<uint8_t>[slots]), words(new atomic<uint64_t>[slots * slotWords]) {
+      for (size_t i = 0; i < slots; ++i)
+        states[i].store(SLOT_EMPTY, memory_order_relaxed);
+      for (size_t i = 0; i < slots * slotWords; ++i)
+        words[i].store(0, memory_order_relaxed);
+    }
+
+    template <typename T> void store(size_t slot, size_t offset, const T &value) {
+      uint64_t buffer[(sizeof(T) + 7) / 8] = {};
+      memcpy(buffer, &value, sizeof(T));
+      for (size_t i = 0; i < (sizeof(T) + 7) / 8; ++i)
+        words[slot * slotWords + offset + i].store(buffer[i], memory_order_relaxed);
+    }
+
+    template <typename T> T load(size_t slot, size_t offset) const {
+      uint64_t buffer[(sizeof(T) + 7) / 8];
+      for (size_t i = 0; i < (sizeof(T) + 7) / 8; ++i)
+        buffer[i] = words[slot * slotWords + offset + i].load(memory_order_relaxed);
+      T value;
+      memcpy(&value, buffer, sizeof(T));
+      return value;
+    }
+
+    // Linear probing, bounded so a torn read can never spin forever
+    size_t find(const KeyType &key, size_t h) const {
+      for (size_t i = 0; i < capacity; ++i) {
+        size_t slot = (h + i) & (capacity - 1);
+        uint8_t state = states[slot].load(memory_order_relaxed);
+        if (state == SLOT_EMPTY)
+          return capacity;
+        if (state == SLOT_FULL && load<KeyType>(slot, 0) == key)
+          return slot;
+      }
+      return capacity;
+    }
+  };
+
+  struct RetiredTable {
+    uint64_t epoch;
+    unique_ptr<Table> table;
+  };
+
+  struct Shard {
+    atomic<uint64_t> sequence{0}; // odd while a writer is changing the table
+    atomic<Table *> table{nullptr};
+    mutex writeMutex;
+    size_t size = 0, used = 0;     // full and full + deleted slots, guarded by writeMutex
+    unique_ptr<Table> current;     // owns table
+    vector<RetiredTable> retired;  // replaced, maybe still being read
+    char padding[64];              // keeps the next shard's sequence off this cache line
+  };
+
+  unique_ptr<Shard[]> shards;
+  size_t shardMask;
+  unsigned shardBits = 0;
+  Hash hasher;
+
+  size_t hashOf(const KeyType &key) const {
+    uint64_t h = (uint64_t)hasher(key) * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h ^ (h >> 32));
+  }
+
+  Shard &shardOf(size_t h) const {
+    return shards[h & shardMask];
+  }
+
+  void beginWrite(Shard &shard) {
+    shard.sequence.store(shard.sequence.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+  }
+
+  void endWrite(Shard &shard) {
+    shard.sequence.store(shard.sequence.load(memory_order_relaxed) + 1, memory_order_release);
+  }
+
+  // Smallest table that keeps entries under 3/8 full, so it takes as many
+  // inserts again before the next rebuild
+  static size_t capacityFor(size_t entries) {
+    size_t capacity = 16;
+    while (capacity * 3 / 4 <= entries * 2)
+      capacity <<= 1;
+    return capacity;
+  }
+
+  void place(Table &table, const KeyType &key, const ValueType &value) {
+    size_t slot = hashOf(key) >> shardBits;
+    while (table.states[slot & (table.capacity - 1)].load(memory_order_relaxed) != SLOT_EMPTY)
+      ++slot;
+    slot &= table.capacity - 1;
+    table.store(slot, 0, key);
+    table.store(slot, keyWords, value);
+    table.states[slot].store(SLOT_FULL, memory_order_relaxed);
+  }
+
+  // Drops the tombstones by reinserting the live entries into the same
+  // table. Readers see the sequence move and retry.
+  void rebuild(Shard &shard, Table &table) {
+    vector<pair<KeyType, ValueType>> live;
+    live.reserve(shard.size);
+    for (size_t slot = 0; slot < table.capacity; ++slot) {
+      if (table.states[slot].load(memory_order_relaxed) == SLOT_FULL)
+        live.push_back(make_pair(table.template load<KeyType>(slot, 0), table.template load<ValueType>(slot, keyWords)));
+      table.states[slot].store(SLOT_EMPTY, memory_order_relaxed);
+    }
+    for (const pair<KeyType, ValueType> &entry : live)
+      place(table, entry.first, entry.second);
+    shard.used = shard.size;
+  }
+
+  // Copies the live entries into a bigger table and publishes it. Readers
+  // keep using the old one until they retry, so it is retired rather than
+  // freed.
+  void grow(Shard &shard) {
+    unique_ptr<Table> grown(new Table(capacityFor(shard.size + 1)));
+    Table *old = shard.current.get();
+    for (size_t slot = 0; old && slot < old->capacity; ++slot) {
+      if (old->states[slot].load(memory_order_relaxed) == SLOT_FULL)
+        place(*grown, old->template load<KeyType>(slot, 0), old->template load<ValueType>(slot, keyWords));
+    }
+    shard.used = shard.size;
+    shard.table.store(grown.get(), memory_order_seq_cst);
+    if (old)
+      shard.retired.push_back(RetiredTable{readerEpochs.retire(), move(shard.current)});
+    shard.current = move(grown);
+    reclaim(shard);
+  }
+
+  void reclaim(Shard &shard) {
+    if (shard.retired.empty())
+      return;
+    uint64_t oldest = readerEpochs.oldestReader();
+    shard.retired.erase(remove_if(shard.retired.begin(), shard.retired.end(), [oldest](const RetiredTable &retired) { return retired.epoch < oldest; }),
+                        shard.retired.end());
+  }
+
+  // Writer side of upsert, with the shard locked and its sequence odd
+  template <typename Update> bool upsertLocked(Shard &shard, const KeyType &key, size_t h, const ValueType &initial, Update update) {
+    Table *table = shard.table.load(memory_order_relaxed);
+    size_t slot = table ? table->find(key, h) : 0;
+    if (table && slot != table->capacity) {
+      ValueType value = table->template load<ValueType>(slot, keyWords);
+      update(value);
+      table->store(slot, keyWords, value);
+      return false;
+    }
+    if (!table || (shard.used + 1) * 4 > table->capacity * 3) {
+      if (table && capacityFor(shard.size + 1) <= table->capacity) {
+        rebuild(shard, *table);
+        reclaim(shard);
+      } else {
+        grow(shard);
+        table = shard.table.load(memory_order_relaxed);
+      }
+    }
+    for (slot = h & (table->capacity - 1); table->states[slot].load(memory_order_relaxed) == SLOT_FULL; slot = (slot + 1) & (table->capacity - 1))
+      ;
+    shard.used += table->states[slot].load(memory_order_relaxed) == SLOT_EMPTY;
+    table->store(slot, 0, key);
+    table->store(slot, keyWords, initial);
+    table->states[slot].store(SLOT_FULL, memory_order_relaxed);
+    shard.size++;
+    return true;
+  }
+
+  public:
+    // shardCount is rounded up to a power of two; a few per thread keeps
+    // writers from meeting often
+    explicit ConcurrentHashtable(size_t shardCount = 64) {
+      size_t count = 1;
+      while (count < shardCount) {
+        count <<= 1;
+        shardBits++;
+      }
+      shards.reset(new Shard[count]);
+      shardMask = count - 1;
+    }
+
+    // Lock-free: copies the value into out and returns true when the key is
+    // there. Retries while a writer is changing the shard.
+    bool find(const KeyType &key, ValueType &out) const {
+      size_t h = hashOf(key);
+      const Shard &shard = shardOf(h);
+      h >>= shardBits;
+      ReaderRecord &reader = readerEpochs.threadRecord();
+      readerEpochs.enter(reader);
+      for (unsigned attempt = 0;; ++attempt) {
+        uint64_t before = shard.sequence.load(memory_order_acquire);
+        if (before & 1) {
+          // The writer may have been preempted, let it finish
+          if (attempt > 64)
+            this_thread::yield();
+          continue;
+        }
+        const Table *table = shard.table.load(memory_order_acquire);
+        size_t slot = table ? table->find(key, h) : 0;
+        bool found = table && slot != table->capacity;
+        if (found)
+          out = table->template load<ValueType>(slot, keyWords);
+        atomic_thread_fence(memory_order_acquire);
+        if (shard.sequence.load(memory_order_relaxed) == before) {
+          readerEpochs.exit(reader);
+          return found;
+        }
+      }
+    }
+
+    bool contains(const KeyType &key) const {
+      ValueType value;
+      return find(key, value);
+    }
+
+    // Inserts key with value or overwrites its value. True if it was new.
+    bool upsert(const KeyType &key, const ValueType &value) {
+      return upsert(key, value, [&value](ValueType &existing) { existing = value; });
+    }
+
+    // Inserts key with initial, or calls update(value) on the value already
+    // there. update runs with the shard locked, so read-modify-write stays
+    // atomic; it should be short.
+    template <typename Update> bool upsert(const KeyType &key, const ValueType &initial, Update update) {
+      size_t h = hashOf(key);
+      Shard &shard = shardOf(h);
+      lock_guard<mutex> lock(shard.writeMutex);
+      beginWrite(shard);
+      bool inserted = upsertLocked(shard, key, h >> shardBits, initial, update);
+      endWrite(shard);
+      return inserted;
+    }
+
+    bool erase(const KeyType &key) {
+      size_t h = hashOf(key);
+      Shard &shard = shardOf(h);
+      lock_guard<mutex> lock(shard.writeMutex);
+      Table *table = shard.table.load(memory_order_relaxed);
+      size_t slot = table ? table->find(key, h >> shardBits) : 0;
+      if (!table || slot == table->capacity)
+        return false;
+      beginWrite(shard);
+      table->states[slot].store(SLOT_DELETED, memory_order_relaxed);
+      shard.size--;
+      endWrite(shard);
+      return true;
+    }
+
+    // Sum over the shards, each locked in turn, so only exact while no
+    // thread writes
+    size_t size() const {
+      size_t total = 0;
+      for (size_t i = 0; i <= shardMask; ++i) {
+        lock_guard<mutex> lock(shards[i].writeMutex);
+        total += shards[i].size;
+      }
+      return total;
+    }
+
+    size_t shardCount() const {
+      return shardMask + 1;
+    }
+};
@@ -1,12 +1,401 @@
+#pragma once
+
 #include <iostream>
-#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <initializer_list>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 using namespace std;
 
+// Transparent hashing for string keys: const char * looks up a string key
+// without building a temporary string first
+struct StringHash {
+  typedef void is_transparent;
+
+  size_t operator()(const char *text, size_t length) const {
+    uint64_t h = 14695981039346656037ull; // FNV-1a
+    for (size_t i = 0; i < length; ++i)
+      h = (h ^ (unsigned char)text[i]) * 1099511628211ull;
+    return (size_t)h;
+  }
+  size_t operator()(const string &key) const {
+    return (*this)(key.data(), key.size());
+  }
+  size_t operator()(const char *key) const {
+    return (*this)(key, strlen(key));
+  }
+};
+
+struct StringEqual {
+  typedef void is_transparent;
+
+  bool operator()(const string &a, const string &b) const {
+    return a == b;
+  }
+  bool operator()(const string &a, const char *b) const {
+    return a == b;
+  }
+};
+
+template <typename KeyType> struct DefaultHash {
+  typedef hash<KeyType> type;
+};
+template <> struct DefaultHash<string> {
+  typedef StringHash type;
+};
+template <typename KeyType> struct DefaultEqual {
+  typedef equal_to<KeyType> type;
+};
+template <> struct DefaultEqual<string> {
+  typedef StringEqual type;
+};
+
+template <typename T, typename = void> struct IsTransparent : false_type {};
+template <typename T> struct IsTransparent<T, typename conditional<true, void, typename T::is_transparent>::type> : true_type {};
+
+// Open addressing hash map in the style of Swiss tables. Slots come in
+// groups of 16, each with a byte of control per slot: empty, deleted, or 7
+// bits of the key's hash. A lookup compares all 16 control bytes of a group
+// at once (SSE2/NEON) and only touches the slots whose bits match, so most
+// misses never read a key. Groups are probed triangularly and entries live
+// in one flat array, no allocation per entry.
+template <typename KeyType, typename ValueType, typename Hash = typename DefaultHash<KeyType>::type,
+          typename Equal = typename DefaultEqual<KeyType>::type>
+class FlatHashMap {
+  public:
+    typedef pair<KeyType, ValueType> value_type;
+
+  private:
+    static const size_t groupWidth = 16;
+    static const int8_t ctrlEmpty = -128;
+    static const int8_t ctrlDeleted = -2;
+
+    // Match masks have one set bit per matching slot
+    struct Group {
+#if defined(__SSE2__)
+      __m128i ctrl;
+      explicit Group(const int8_t *bytes) : ctrl(_mm_loadu_si128((const __m128i *)bytes)) {}
+      uint64_t match(int8_t h2) const {
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+      }
+      uint64_t matchEmptyOrDeleted() const {
+        return (uint32_t)_mm_movemask_epi8(ctrl); // only the two markers are negative
+      }
+      static size_t slotOf(uint64_t mask) {
+        return __builtin_ctzll(mask);
+      }
+#elif defined(__ARM_NEON)
+      // NEON has no movemask, narrowing leaves four bits per byte
+      int8x16_t ctrl;
+      explicit Group(const int8_t *bytes) : ctrl(vld1q_s8(bytes)) {}
+      static uint64_t toMask(uint8x16_t bytes) {
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(bytes), 4)), 0) & 0x8888888888888888ull;
+      }
+      uint64_t match(int8_t h2) const {
+        return toMask(vceqq_s8(ctrl, vdupq_n_s8(h2)));
+      }
+      uint64_t matchEmptyOrDeleted() const {
+        return toMask(vcltq_s8(ctrl, vdupq_n_s8(0)));
+      }
+      static size_t slotOf(uint64_t mask) {
+        return __builtin_ctzll(mask) >> 2;
+      }
+#else
+      const int8_t *ctrl;
+      explicit Group(const int8_t *bytes) : ctrl(bytes) {}
+      uint64_t match(int8_t h2) const {
+        uint64_t mask = 0;
+        for (size_t i = 0; i < groupWidth; ++i)
+          mask |= (uint64_t)(ctrl[i] == h2) << i;
+        return mask;
+      }
+      uint64_t matchEmptyOrDeleted() const {
+        uint64_t mask = 0;
+        for (size_t i = 0; i < groupWidth; ++i)
+          mask |= (uint64_t)(ctrl[i] < 0) << i;
+        return mask;
+      }
+      static size_t slotOf(uint64_t mask) {
+        return __builtin_ctzll(mask);
+      }
+#endif
+      uint64_t matchEmpty() const {
+        return match(ctrlEmpty);
+      }
+    };
+
+    int8_t *ctrl = emptyGroup();
+    value_type *slots = nullptr;
+    size_t capacity_ = 0; // slots, a power of two and a multiple of groupWidth
+    size_t size_ = 0;
+    size_t deleted = 0;
+    Hash hasher;
+    Equal equal;
+
+    // Lets lookups in a table without storage run the normal probe loop
+    static int8_t *emptyGroup() {
+      static int8_t group[groupWidth] = {ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty,
+                                         ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty, ctrlEmpty};
+      return group;
+    }
+
+    // std::hash of an integer is the integer itself; both the group index
+    // and the 7 control bits need well mixed bits
+    template <typename K> size_t hashOf(const K &key) const {
+      uint64_t h = (uint64_t)hasher(key) * 0x9E3779B97F4A7C15ull;
+      return (size_t)(h ^ (h >> 32));
+    }
+
+    size_t groupMask() const {
+      return capacity_ ? capacity_ / groupWidth - 1 : 0;
+    }
+
+    size_t growthLimit() const {
+      return capacity_ - capacity_ / 8;
+    }
+
+    template <typename K> size_t findIndex(const K &key) const {
+      size_t h = hashOf(key);
+      int8_t h2 = h & 0x7F;
+      size_t group = (h >> 7) & groupMask();
+      for (size_t step = 1;; ++step) {
+        Group g(ctrl + group * groupWidth);
+        for (uint64_t mask = g.match(h2); mask; mask &= mask - 1) {
+          size_t index = group * groupWidth + Group::slotOf(mask);
+          if (equal(slots[index].first, key))
+            return index;
+        }
+        if (g.matchEmpty())
+          return capacity_;
+        group = (group + step) & groupMask();
+      }
+    }
+
+    // First empty or deleted slot on the probe sequence of hash h
+    size_t findFree(size_t h) const {
+      size_t group = (h >> 7) & groupMask();
+      for (size_t step = 1;; ++step) {
+        uint64_t mask = Group(ctrl + group * groupWidth).matchEmptyOrDeleted();
+        if (mask)
+          return group * groupWidth + Group::slotOf(mask);
+        group = (group + step) & groupMask();
+      }
+    }
+
+    void rehash(size_t newCapacity) {
+      int8_t *oldCtrl = ctrl;
+      value_type *oldSlots = slots;
+      size_t oldCapacity = capacity_;
+
+      ctrl = new int8_t[newCapacity];
+      memset(ctrl, ctrlEmpty, newCapacity);
+      slots = static_cast<value_type *>(::operator new(newCapacity * sizeof(value_type)));
+      capacity_ = newCapacity;
+      deleted = 0;
+      for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldCtrl[i] < 0)
+          continue;
+        size_t h = hashOf(oldSlots[i].first);
+        size_t index = findFree(h);
+        ctrl[index] = h & 0x7F;
+        new (&slots[index]) value_type(move(oldSlots[i]));
+        oldSlots[i].~value_type();
+      }
+      if (oldCapacity) {
+        delete[] oldCtrl;
+        ::operator delete(oldSlots);
+      }
+    }
+
+    // Room for one more entry, rehashing in place if tombstones take it up
+    void prepareInsert() {
+      if (size_ + deleted < growthLimit())
+        return;
+      if (capacity_ && size_ < growthLimit() / 2)
+        rehash(capacity_);
+      else
+        rehash(capacity_ ? capacity_ * 2 : groupWidth);
+    }
+
+    template <typename K> size_t insertIndex(K &&key) {
+      size_t index = findIndex(key);
+      if (index != capacity_)
+        return index;
+      prepareInsert();
+      size_t h = hashOf(key);
+      index = findFree(h);
+      deleted -= ctrl[index] == ctrlDeleted;
+      ctrl[index] = h & 0x7F;
+      new (&slots[index]) value_type(forward<K>(key), ValueType());
+      size_++;
+      return index;
+    }
+
+    void destroy() {
+      for (size_t i = 0; i < capacity_; ++i)
+        if (ctrl[i] >= 0)
+          slots[i].~value_type();
+      if (capacity_) {
+        delete[] ctrl;
+        ::operator delete(slots);
+      }
+      ctrl = emptyGroup();
+      slots = nullptr;
+      capacity_ = size_ = deleted = 0;
+    }
+
+    template <typename K> using EnableIfTransparent =
+        typename enable_if<IsTransparent<Hash>::value && IsTransparent<Equal>::value && !is_same<K, KeyType>::value>::type;
+
+  public:
+    FlatHashMap() = default;
+
+    FlatHashMap(const FlatHashMap &other) : hasher(other.hasher), equal(other.equal) {
+      reserve(other.size_);
+      other.forEach([this](const KeyType &key, const ValueType &value) { (*this)[key] = value; });
+    }
+
+    FlatHashMap(FlatHashMap &&other) {
+      swap(other);
+    }
+
+    FlatHashMap &operator=(FlatHashMap other) {
+      swap(other);
+      return *this;
+    }
+
+    ~FlatHashMap() {
+      destroy();
+    }
+
+    void swap(FlatHashMap &other) {
+      std::swap(ctrl, other.ctrl);
+      std::swap(slots, other.slots);
+      std::swap(capacity_, other.capacity_);
+      std::swap(size_, other.size_);
+      std::swap(deleted, other.deleted);
+      std::swap(hasher, other.hasher);
+      std::swap(equal, other.equal);
+    }
+
+    size_t size() const {
+      return size_;
+    }
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    size_t capacity() const {
+      return capacity_;
+    }
+
+    // Makes room for count entries without rehashing again
+    void reserve(size_t count) {
+      size_t needed = groupWidth;
+      while (needed - needed / 8 <= count)
+        needed <<= 1;
+      if (needed > capacity_)
+        rehash(needed);
+    }
+
+    // nullptr on a miss, which leaves the map as it was
+    ValueType *find(const KeyType &key) {
+      size_t index = findIndex(key);
+      return index == capacity_ ? nullptr : &slots[index].second;
+    }
+
+    const ValueType *find(const KeyType &key) const {
+      size_t index = findIndex(key);
+      return index == capacity_ ? nullptr : &slots[index].second;
+    }
+
+    // Heterogeneous lookup, for maps whose Hash and Equal are transparent
+    template <typename K, typename = EnableIfTransparent<K>> ValueType *find(const K &key) {
+      size_t index = findIndex(key);
+      return index == capacity_ ? nullptr : &slots[index].second;
+    }
+
+    template <typename K, typename = EnableIfTransparent<K>> const ValueType *find(const K &key) const {
+      size_t index = findIndex(key);
+      return index == capacity_ ? nullptr : &slots[index].second;
+    }
+
+    bool contains(const KeyType &key) const {
+      return find(key) != nullptr;
+    }
+
+    // Inserting may rehash, so slots is only read once the index is known
+    ValueType &operator[](const KeyType &key) {
+      size_t index = insertIndex(key);
+      return slots[index].second;
+    }
+
+    ValueType &operator[](KeyType &&key) {
+      size_t index = insertIndex(move(key));
+      return slots[index].second;
+    }
+
+    // Returns false, and leaves the value alone, if the key was there
+    bool insert(const KeyType &key, const ValueType &value) {
+      size_t before = size_;
+      ValueType &slot = (*this)[key];
+      if (size_ == before)
+        return false;
+      slot = value;
+      return true;
+    }
+
+    bool erase(const KeyType &key) {
+      size_t index = findIndex(key);
+      if (index == capacity_)
+        return false;
+      slots[index].~value_type();
+      // Probes stop at the first group with an empty slot. If this group
+      // has one, no probe can be passing through it and the slot can be
+      // emptied instead of leaving a tombstone.
+      size_t group = index / groupWidth * groupWidth;
+      if (Group(ctrl + group).matchEmpty()) {
+        ctrl[index] = ctrlEmpty;
+      } else {
+        ctrl[index] = ctrlDeleted;
+        deleted++;
+      }
+      size_--;
+      return true;
+    }
+
+    void clear() {
+      for (size_t i = 0; i < capacity_; ++i) {
+        if (ctrl[i] >= 0)
+          slots[i].~value_type();
+        ctrl[i] = ctrlEmpty;
+      }
+      size_ = deleted = 0;
+    }
+
+    // Calls visit(key, value) for every entry, in no particular order
+    template <typename Visitor> void forEach(Visitor visit) const {
+      for (size_t i = 0; i < capacity_; ++i)
+        if (ctrl[i] >= 0)
+          visit(slots[i].first, slots[i].second);
+    }
+};
+
 template <typename KeyType, typename ValueType>
 class Hashtable {
-  unordered_map<KeyType, ValueType> htmap;
+  FlatHashMap<KeyType, ValueType> htmap;
 
   public:
     // Default constructor
@@ -14,6 +403,7 @@ class Hashtable {
 
     // Constructor with initializer list
     Hashtable(initializer_list<pair<KeyType, ValueType>> initList) {
+      htmap.reserve(initList.size());
       for (const auto& entry : initList) {
         htmap[entry.first] = entry.second;
       }
@@ -23,7 +413,31 @@ class Hashtable {
       htmap[key] = value;
     }
 
-    ValueType get(const KeyType& key) {
-      return htmap[key];
+    // A missing key reads as a default value and is not added
+    ValueType get(const KeyType& key) const {
+      const ValueType *value = htmap.find(key);
+      return value ? *value : ValueType();
+    }
+
+    // nullptr when the key is missing. Takes anything the key type's hash
+    // accepts, const char * for string keys.
+    template <typename K> ValueType *find(const K& key) {
+      return htmap.find(key);
+    }
+
+    template <typename K> const ValueType *find(const K& key) const {
+      return htmap.find(key);
+    }
+
+    bool erase(const KeyType& key) {
+      return htmap.erase(key);
+    }
+
+    void reserve(size_t count) {
+      htmap.reserve(count);
+    }
+
+    size_t size() const {
+      return htmap.size();
     }
 };
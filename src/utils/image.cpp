@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// Writes RGBA pixels as a binary PPM (alpha dropped). bottomUp is for GL
+// readbacks, whose first row is the bottom of the image.
+bool writePPM(const string &path, const unsigned char *rgba, int width, int height, bool bottomUp)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+
+  fprintf(file, "P6\n%d %d\n255\n", width, height);
+  vector<unsigned char> row(width * 3);
+  for (int i = 0; i < height; ++i)
+  {
+    int y = bottomUp ? height - 1 - i : i;
+    const unsigned char *src = rgba + (size_t)y * width * 4;
+    for (int x = 0; x < width; ++x)
+    {
+      row[x * 3] = src[x * 4];
+      row[x * 3 + 1] = src[x * 4 + 1];
+      row[x * 3 + 2] = src[x * 4 + 2];
+    }
+    fwrite(row.data(), 1, row.size(), file);
+  }
+  fclose(file);
+  return true;
+}
+
+unsigned int pngCrc32(unsigned int crc, const unsigned char *data, size_t length)
+{
+  static unsigned int table[256];
+  static bool tableReady = false;
+  if (!tableReady)
+  {
+    for (unsigned int n = 0; n < 256; ++n)
+    {
+      unsigned int c = n;
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+    tableReady = true;
+  }
+  crc = ~crc;
+  for (size_t i = 0; i < length; ++i)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+void writePNGChunk(FILE *file, const char *type, const vector<unsigned char> &data)
+{
+  unsigned char header[8] = {(unsigned char)(data.size() >> 24), (unsigned char)(data.size() >> 16),
+                             (unsigned char)(data.size() >> 8), (unsigned char)data.size(),
+                             (unsigned char)type[0], (unsigned char)type[1], (unsigned char)type[2], (unsigned char)type[3]};
+  unsigned int crc = pngCrc32(0, header + 4, 4);
+  crc = pngCrc32(crc, data.data(), data.size());
+  unsigned char footer[4] = {(unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc};
+  fwrite(header, 1, 8, file);
+  fwrite(data.data(), 1, data.size(), file);
+  fwrite(footer, 1, 4, file);
+}
+
+// Writes RGBA pixels as a PNG. The deflate stream uses stored (uncompressed)
+// blocks: no zlib dependency, and cheap enough for a capture thread.
+bool writePNG(const string &path, const unsigned char *rgba, int width, int height, bool bottomUp)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+
+  const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  fwrite(signature, 1, 8, file);
+
+  vector<unsigned char> ihdr = {(unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+                                (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+                                8, 6, 0, 0, 0};
+  writePNGChunk(file, "IHDR", ihdr);
+
+  // Scanlines with filter type 0
+  size_t stride = (size_t)width * 4;
+  vector<unsigned char> raw;
+  raw.reserve((stride + 1) * height);
+  for (int i = 0; i < height; ++i)
+  {
+    int y = bottomUp ? height - 1 - i : i;
+    raw.push_back(0);
+    raw.insert(raw.end(), rgba + y * stride, rgba + (y + 1) * stride);
+  }
+
+  vector<unsigned char> idat;
+  idat.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+  idat.push_back(0x78);
+  idat.push_back(0x01);
+  unsigned int a = 1, b = 0;
+  for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535)
+  {
+    size_t length = min((size_t)65535, raw.size() - offset);
+    bool last = offset + length >= raw.size();
+    idat.push_back(last ? 1 : 0);
+    idat.push_back(length & 0xFF);
+    idat.push_back(length >> 8);
+    idat.push_back(~length & 0xFF);
+    idat.push_back((~length >> 8) & 0xFF);
+    idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + length);
+    for (size_t i = offset; i < offset + length; ++i)
+    {
+      a = (a + raw[i]) % 65521;
+      b = (b + a) % 65521;
+    }
+    if (last)
+      break;
+  }
+  unsigned int adler = (b << 16) | a;
+  idat.push_back(adler >> 24);
+  idat.push_back(adler >> 16);
+  idat.push_back(adler >> 8);
+  idat.push_back(adler);
+  writePNGChunk(file, "IDAT", idat);
+  writePNGChunk(file, "IEND", {});
+
+  bool ok = ferror(file) == 0;
+  return fclose(file) == 0 && ok;
+}
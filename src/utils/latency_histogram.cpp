@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <algorithm>
+
+using namespace std;
+
+// Counts durations in power-of-two millisecond buckets: under 1 ms, 1-2 ms,
+// 2-4 ms and so on, the last bucket takes everything longer. Recording is a
+// few instructions, so it can stay on in release builds.
+class LatencyHistogram
+{
+  static const int bucketCount = 12;
+
+  uint64_t buckets[bucketCount] = {};
+  uint64_t total = 0;
+  double sumMs = 0.0;
+  double maxMs = 0.0;
+
+  static double upperBound(int bucket)
+  {
+    return (double)(1 << bucket);
+  }
+
+  public:
+    void record(chrono::steady_clock::duration latency)
+    {
+      double ms = chrono::duration<double, milli>(latency).count();
+      if (ms < 0.0)
+        ms = 0.0;
+      int bucket = 0;
+      while (bucket < bucketCount - 1 && ms >= upperBound(bucket))
+        ++bucket;
+      buckets[bucket]++;
+      total++;
+      sumMs += ms;
+      if (ms > maxMs)
+        maxMs = ms;
+    }
+
+    uint64_t count() const
+    {
+      return total;
+    }
+
+    double meanMs() const
+    {
+      return total ? sumMs / total : 0.0;
+    }
+
+    // Upper bound of the bucket holding the given fraction of samples
+    double percentileMs(double fraction) const
+    {
+      uint64_t seen = 0;
+      for (int i = 0; i < bucketCount; ++i)
+      {
+        seen += buckets[i];
+        if (seen > 0 && seen >= fraction * total)
+          return i == bucketCount - 1 ? maxMs : min(upperBound(i), maxMs);
+      }
+      return 0.0;
+    }
+
+    void print(ostream &out, const string &title) const
+    {
+      out << title << ": " << total << " samples, mean " << meanMs() << " ms, p50 < " << percentileMs(0.5) << " ms, p99 < "
+          << percentileMs(0.99) << " ms, max " << maxMs << " ms" << endl;
+      if (total == 0)
+        return;
+      for (int i = 0; i < bucketCount; ++i)
+      {
+        if (buckets[i] == 0)
+          continue;
+        string label = i == bucketCount - 1 ? ">= " + to_string((int)upperBound(i - 1)) : "< " + to_string((int)upperBound(i));
+        out << "  " << label << " ms" << string(10 - label.size(), ' ') << string(buckets[i] * 40 / total, '#') << " " << buckets[i] << endl;
+      }
+    }
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Bounded single-producer single-consumer ring buffer. push() and pop()
+// never block or allocate; a full queue makes push() fail so the producer
+// decides what to drop.
+template <typename T>
+class SpscQueue
+{
+  vector<T> slots;
+  size_t mask;
+  alignas(64) atomic<size_t> head{0}; // next slot to pop, owned by the consumer
+  alignas(64) atomic<size_t> tail{0}; // next slot to push, owned by the producer
+
+  public:
+    // Capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+    {
+      size_t size = 1;
+      while (size < capacity)
+        size <<= 1;
+      slots.resize(size);
+      mask = size - 1;
+    }
+
+    bool push(const T &value)
+    {
+      size_t t = tail.load(memory_order_relaxed);
+      if (t - head.load(memory_order_acquire) == slots.size())
+        return false;
+      slots[t & mask] = value;
+      tail.store(t + 1, memory_order_release);
+      return true;
+    }
+
+    bool pop(T &value)
+    {
+      size_t h = head.load(memory_order_relaxed);
+      if (h == tail.load(memory_order_acquire))
+        return false;
+      value = slots[h & mask];
+      head.store(h + 1, memory_order_release);
+      return true;
+    }
+
+    // Peeks at the oldest entry without removing it
+    bool front(T &value) const
+    {
+      size_t h = head.load(memory_order_relaxed);
+      if (h == tail.load(memory_order_acquire))
+        return false;
+      value = slots[h & mask];
+      return true;
+    }
+
+    size_t size() const
+    {
+      return tail.load(memory_order_acquire) - head.load(memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+      return slots.size();
+    }
+};
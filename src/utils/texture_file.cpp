@@ -0,0 +1,175 @@
+#pragma once
+
+// Precooked textures (.tex): a small header, a mip table and the raw pixels
+// of every level, ready to hand to glTexImage2D without decoding. Written by
+// texture_cooker, mapped straight into memory at load time. Fields are
+// little endian, like every platform the game runs on. The header records
+// the size, modification time and a hash of the image it was cooked from,
+// so a .tex left behind after the image changed is not loaded.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const char textureFileMagic[4] = {'S', 'N', 'K', 'T'};
+const uint32_t textureFileVersion = 3;
+
+enum TextureFileFormat
+{
+  TEXTURE_RGBA8 = 0,
+  TEXTURE_ETC2_RGBA8 = 1 // Reserved, GLES2 and WebGL 1 cannot sample it
+};
+
+enum TextureFileFlags
+{
+  TEXTURE_PREMULTIPLIED = 1 // Colour already multiplied by alpha, blend with GL_ONE
+};
+
+struct TextureFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t format;
+  uint32_t flags;
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipCount;
+  uint32_t reserved;
+  uint64_t sourceSize;
+  uint64_t sourceMtime; // Nanoseconds since the epoch
+  uint64_t sourceHash;  // FNV-1a of the source file's bytes
+};
+
+// Offsets are from the start of the file and 16 byte aligned
+struct TextureFileMip
+{
+  uint32_t width;
+  uint32_t height;
+  uint64_t offset;
+  uint64_t size;
+};
+
+const uint32_t maxTextureMips = 16;
+const uint32_t maxTextureSize = 16384;
+
+struct MappedTexture
+{
+  const TextureFileHeader *header = nullptr;
+  const TextureFileMip *mips = nullptr;
+  const unsigned char *bytes = nullptr;
+  size_t size = 0;
+};
+
+void unmapTextureFile(MappedTexture &texture)
+{
+  if (texture.bytes)
+    munmap((void *)texture.bytes, texture.size);
+  texture = MappedTexture();
+}
+
+// Maps a .tex file read-only and checks that every level has the size the
+// header implies (each half the last, at least 1) and lies inside the file
+// after the mip table. Pages are only read in when the upload touches them.
+bool mapTextureFile(const string &path, MappedTexture &texture)
+{
+  texture = MappedTexture();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TextureFileHeader))
+  {
+    close(fd);
+    return false;
+  }
+  void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  texture.bytes = (const unsigned char *)mapping;
+  texture.size = info.st_size;
+  texture.header = (const TextureFileHeader *)texture.bytes;
+  texture.mips = (const TextureFileMip *)(texture.bytes + sizeof(TextureFileHeader));
+
+  const TextureFileHeader &header = *texture.header;
+  size_t tableEnd = sizeof(TextureFileHeader) + header.mipCount * sizeof(TextureFileMip);
+  bool valid = memcmp(header.magic, textureFileMagic, 4) == 0 && header.version == textureFileVersion &&
+               header.format == TEXTURE_RGBA8 && header.mipCount >= 1 && header.mipCount <= maxTextureMips &&
+               header.width >= 1 && header.width <= maxTextureSize && header.height >= 1 && header.height <= maxTextureSize &&
+               tableEnd <= texture.size;
+  uint32_t width = header.width, height = header.height;
+  for (uint32_t level = 0; valid && level < header.mipCount; ++level)
+  {
+    const TextureFileMip &mip = texture.mips[level];
+    valid = mip.width == width && mip.height == height && mip.size == (uint64_t)width * height * 4 && mip.offset >= tableEnd &&
+            mip.offset <= texture.size && mip.size <= texture.size - mip.offset;
+    width = max(width / 2, 1u);
+    height = max(height / 2, 1u);
+  }
+  if (!valid)
+  {
+    unmapTextureFile(texture);
+    return false;
+  }
+  return true;
+}
+
+// Size and FNV-1a hash of a file's contents. Source images are small, the
+// atlas takes tens of microseconds.
+bool hashSourceFile(const string &path, uint64_t &size, uint64_t &hash)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  size = 0;
+  hash = 0xcbf29ce484222325ull;
+  unsigned char buffer[65536];
+  ssize_t count;
+  while ((count = read(fd, buffer, sizeof(buffer))) > 0)
+  {
+    for (ssize_t i = 0; i < count; ++i)
+      hash = (hash ^ buffer[i]) * 0x100000001b3ull;
+    size += count;
+  }
+  close(fd);
+  return count == 0;
+}
+
+// Size and modification time of a file, without reading it
+bool statSourceFile(const string &path, uint64_t &size, uint64_t &mtime)
+{
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0)
+    return false;
+  size = info.st_size;
+  mtime = (uint64_t)info.st_mtim.tv_sec * 1000000000ull + info.st_mtim.tv_nsec;
+  return true;
+}
+
+// True when the texture was cooked from the file at sourcePath as it is now.
+// An unchanged size and mtime is trusted; the file is only hashed when they
+// differ, such as after a fresh checkout.
+bool textureMatchesSource(const TextureFileHeader &header, const string &sourcePath)
+{
+  uint64_t size, mtime, hash;
+  if (!statSourceFile(sourcePath, size, mtime) || size != header.sourceSize)
+    return false;
+  if (mtime == header.sourceMtime)
+    return true;
+  return hashSourceFile(sourcePath, size, hash) && size == header.sourceSize && hash == header.sourceHash;
+}
+
+// atlas.png -> atlas.tex
+string cookedTexturePath(const string &path)
+{
+  size_t dot = path.rfind('.');
+  return (dot == string::npos ? path : path.substr(0, dot)) + ".tex";
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+
+using namespace std;
+
+// Lock-free single-producer single-consumer handoff of the latest value.
+// The producer fills the back slot and swaps it with the shared middle slot,
+// the consumer swaps the middle slot with its front slot when a fresh one is
+// waiting. Neither side ever waits for the other; values the consumer was
+// too slow to pick up are overwritten.
+template <typename T>
+class TripleBuffer
+{
+  static const unsigned freshBit = 4;
+
+  T slots[3];
+  alignas(64) atomic<unsigned> middle{1}; // slot index, freshBit once published
+  alignas(64) unsigned back = 0;          // owned by the producer
+  alignas(64) unsigned front = 2;         // owned by the consumer
+
+  public:
+    // Producer: the slot to fill. It holds an older value, not the last one
+    // published, so it has to be written in full.
+    T &writeSlot()
+    {
+      return slots[back];
+    }
+
+    void publish()
+    {
+      back = middle.exchange(back | freshBit, memory_order_acq_rel) & ~freshBit;
+    }
+
+    // Consumer: true when a value newer than read() has been published
+    bool hasFresh() const
+    {
+      return (middle.load(memory_order_acquire) & freshBit) != 0;
+    }
+
+    // Consumer: moves the newest published value into read()
+    bool update()
+    {
+      if (!hasFresh())
+        return false;
+      front = middle.exchange(front, memory_order_acq_rel) & ~freshBit;
+      return true;
+    }
+
+    const T &read() const
+    {
+      return slots[front];
+    }
+};
@@ -15,6 +15,8 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "../src/render/text_mesh.cpp"
+#include "../src/render/cooked_texture.cpp"
 
 const char foodSound[18] = "/web/res/food.ogg";
 const char moveSound[18] = "/web/res/move.ogg";
@@ -24,8 +26,7 @@ const char music[19] = "/web/res/music.ogg";
 using namespace std;
 using namespace chrono;
 
-const char fontTexturePath[25] = "web/res/font_texture.png";
-const char snakeTexturePath[27] = "web/res/snake-graphics.png";
+const char atlasTexturePath[18] = "web/res/atlas.png";
 // Constants
 const int columns = 50;
 const int rows = 50;
@@ -296,6 +297,13 @@ void drawSquare(GLuint program, float x, float y, float size, float r, float g,
 
 GLuint loadTexture(const char *filename)
 {
+  // A precooked .tex next to the image (make textures) skips decoding and
+  // already carries its mips, if it was cooked from the image as it is now.
+  // The game blends straight alpha, so a premultiplied one is not used.
+  GLuint cooked = loadCookedTexture(cookedTexturePath(filename), filename, true);
+  if (cooked)
+    return cooked;
+
   GLuint texture;
   glGenTextures(1, &texture);
   glBindTexture(GL_TEXTURE_2D, texture);
@@ -316,77 +324,16 @@ GLuint loadTexture(const char *filename)
   return texture;
 }
 
-void renderText(GLuint program, GLuint texture, const string &text, float x, float y, float scale, float r, float g, float b, bool center = false)
+Quad spriteQuad(const AtlasRect &sprite, float x, float y)
 {
-  glUseProgram(program);
-  glBindTexture(GL_TEXTURE_2D, texture);
-
-  float charWidth = 1.0f / 16.0f; // Assuming 16x16 grid of characters
-  float charHeight = 1.0f / 16.0f;
-
-  // Calculate the total width of the text if centering is enabled
-  if (center)
-  {
-    float textWidth = text.size() * scale;
-    x -= textWidth / 2.0f; // Adjust the x position to center the text
-  }
-
-  for (char c : text)
-  {
-    int charIndex = c - 32; // Assuming the texture starts with ASCII 32 (space)
-    int col = charIndex % 16;
-    int row = charIndex / 16;
-
-    float tx1 = col * charWidth;
-    float ty1 = row * charHeight;
-    float tx2 = tx1 + charWidth;
-    float ty2 = ty1 + charHeight;
-
-    float vertices[] = {
-        x, y, tx1, ty2,
-        x + scale, y, tx2, ty2,
-        x + scale, y + scale, tx2, ty1,
-        x, y + scale, tx1, ty1};
-
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    GLint posLoc = glGetAttribLocation(program, "aPosition");
-    GLint texLoc = glGetAttribLocation(program, "aTexCoord");
-
-    glEnableVertexAttribArray(posLoc);
-    glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(texLoc);
-    glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
-
-    GLint colorLoc = glGetUniformLocation(program, "uColor");
-    glUniform3f(colorLoc, r, g, b);
-
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-    glDisableVertexAttribArray(posLoc);
-    glDisableVertexAttribArray(texLoc);
-    glDeleteBuffers(1, &vbo);
-
-    x += scale; // Move to the next character position
-  }
+  // Atlas rows run top to bottom, flip v
+  return makeQuad(x, y, snakeWidth, snakeHeight, sprite.u1, sprite.v2, sprite.u2, sprite.v1);
 }
 
-void drawTexturedSquare(GLuint program, GLuint texture, float x, float y, int i)
+Quad snakeSegmentQuad(size_t i)
 {
-  glUseProgram(program);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glDepthMask(GL_TRUE);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  float charWidth = 1.0f / 5.0f; // Assuming 16x16 grid of characters
-  float charHeight = 1.0f / 4.0f;
-
-  float segx = x;
-  float segy = y;
+  float segx = snakeBody[i].x;
+  float segy = snakeBody[i].y;
 
   // Sprite column and row that gets calculated
   int tx = 0;
@@ -493,102 +440,37 @@ void drawTexturedSquare(GLuint program, GLuint texture, float x, float y, int i)
     }
   }
 
-  float tx1 = tx * charWidth;
-  float ty1 = ty * charHeight;
-  float tx2 = tx1 + charWidth;
-  float ty2 = ty1 + charHeight;
-
-  float vertices[] = {
-      x, y, tx1, ty2,
-      x + snakeWidth, y, tx2, ty2,
-      x + snakeWidth, y + snakeHeight, tx2, ty1,
-      x, y + snakeHeight, tx1, ty1};
-
-  GLuint vbo;
-  glGenBuffers(1, &vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  GLint posLoc = glGetAttribLocation(program, "aPosition");
-  GLint texLoc = glGetAttribLocation(program, "aTexCoord");
-
-  glEnableVertexAttribArray(posLoc);
-  glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(texLoc);
-  glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
-
-  GLint colorLoc = glGetUniformLocation(program, "uColor");
-  glUniform3f(colorLoc, 1.0f, 1.0f, 1.0f);
-
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-  glDisableVertexAttribArray(posLoc);
-  glDisableVertexAttribArray(texLoc);
-  glDeleteBuffers(1, &vbo);
+  return spriteQuad(snakeRects[ty * snakeColumns + tx], segx, segy);
 }
-void drawTexturedFruit(GLuint program, GLfloat x, GLfloat y)
-{
-  GLuint texture = loadTexture(snakeTexturePath);
-  glUseProgram(program);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glDepthMask(GL_TRUE);
-  glBlendFunc(GL_TEXTURE_2D, GL_TEXTURE_ALPHA_TYPE);
-
-  float charWidth = 1.0f / 5.0f; // Assuming 16x16 grid of characters
-  float charHeight = 1.0f / 4.0f;
-
-  int tx = 0;
-  int ty = 3;
-  float tx1 = tx * charWidth;
-  float ty1 = ty * charHeight;
-  float tx2 = tx1 + charWidth;
-  float ty2 = ty1 + charHeight;
-
-  float vertices[] = {
-      x, y, tx1, ty2,
-      x + snakeWidth, y, tx2, ty2,
-      x + snakeWidth, y + snakeHeight, tx2, ty1,
-      x, y + snakeHeight, tx1, ty1};
-
-  GLuint vbo;
-  glGenBuffers(1, &vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-  GLint posLoc = glGetAttribLocation(program, "aPosition");
-  GLint texLoc = glGetAttribLocation(program, "aTexCoord");
-
-  glEnableVertexAttribArray(posLoc);
-  glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(texLoc);
-  glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
-
-  GLint colorLoc = glGetUniformLocation(program, "uColor");
-  glUniform3f(colorLoc, 1.0f, 1.0f, 1.0f);
-
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-  glDisableVertexAttribArray(posLoc);
-  glDisableVertexAttribArray(texLoc);
-  glDeleteBuffers(1, &vbo);
-}
 // GLUT callbacks
 GLuint program;
-
-void drawSnake()
+GLint posLoc, texLoc;
+GLuint atlasTexture;
+
+// Text meshes, the static ones are laid out once and the score only when it changes
+TextMesh scoreText;
+TextMesh gameOverText;
+TextMesh gameOverScoreText;
+TextMesh restartText;
+
+// Snake, fruit and text all sample the packed atlas, bound once. Text
+// meshes keep their own static buffers and upload only when the text
+// changes; the snake and fruit, which change every tick, are collected into
+// one streamed buffer and drawn with a single call.
+vector<Quad> frameQuads;
+GLuint frameBuffer = 0;
+
+void addSnake()
 {
-  GLuint snakeTexture = loadTexture(snakeTexturePath);
   for (size_t i = 0; i < snakeBody.size(); ++i)
-  {
-    const auto segment = snakeBody[i];
-    drawTexturedSquare(program, snakeTexture, segment.x, segment.y, i);
-  }
+    frameQuads.push_back(snakeSegmentQuad(i));
 }
 
 void drawScore()
 {
-  GLuint fontTexture = loadTexture(fontTexturePath);
-  renderText(program, fontTexture, "SCORE:" + to_string(playerScore), -0.9f, 0.85f, 0.07f, 1.0f, 1.0f, 1.0f, false);
+  scoreText.build("SCORE:" + to_string(playerScore), -0.9f, 0.85f, 0.07f);
+  scoreText.draw(posLoc, texLoc);
 }
 
 void drawGameover()
@@ -598,23 +480,40 @@ void drawGameover()
     playAudio(gameOverSound);
     gameOverSoundPlayed = true;
   }
-  GLuint fontTexture = loadTexture(fontTexturePath);
-  renderText(program, fontTexture, "GAME OVER!", 0.0f, 0.7f, 0.13f, 1.0f, 1.0f, 1.0f, true);
-  renderText(program, fontTexture, "SCORE:" + to_string(playerScore), 0.0f, 0.58f, 0.1f, 1.0f, 1.0f, 1.0f, true);
-  renderText(program, fontTexture, "\"SPACE\" TO RESTART", 0.0f, 0.48f, 0.08f, 1.0f, 1.0f, 1.0f, true);
+  gameOverScoreText.build("SCORE:" + to_string(playerScore), 0.0f, 0.58f, 0.1f, true);
+  gameOverText.draw(posLoc, texLoc);
+  gameOverScoreText.draw(posLoc, texLoc);
+  restartText.draw(posLoc, texLoc);
+}
+
+void drawFrameQuads()
+{
+  if (frameQuads.empty())
+    return;
+
+  glBindBuffer(GL_ARRAY_BUFFER, frameBuffer);
+  glBufferData(GL_ARRAY_BUFFER, frameQuads.size() * sizeof(Quad), frameQuads.data(), GL_STREAM_DRAW);
+
+  glEnableVertexAttribArray(posLoc);
+  glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)0);
+  glEnableVertexAttribArray(texLoc);
+  glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void *)(2 * sizeof(float)));
+
+  glDrawArrays(GL_TRIANGLES, 0, frameQuads.size() * 6);
+
+  glDisableVertexAttribArray(posLoc);
+  glDisableVertexAttribArray(texLoc);
 }
 
+// Redraws are requested only when the board changed
+bool frameDirty = false;
+
 void display()
 {
   glClearColor(0.01f, 0.01f, 0.01f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  GLint useFontTextureLoc = glGetUniformLocation(program, "uUseFontTexture");
-  glUniform1i(useFontTextureLoc, 1);
-
-  GLint useTextureLoc = glGetUniformLocation(program, "uUseTexture");
-  glUniform1i(useTextureLoc, 0);
-
+  frameQuads.clear();
   if (isGameOver)
   {
     drawGameover();
@@ -622,19 +521,13 @@ void display()
   else
   {
     drawScore();
-
-    glUniform1i(useFontTextureLoc, 0);
-    glUniform1i(useTextureLoc, 1);
-
-    drawTexturedFruit(program, fruitX, fruitY);
-
-    glUniform1i(useFontTextureLoc, 0);
-    glUniform1i(useTextureLoc, 1);
-
-    drawSnake();
+    frameQuads.push_back(spriteQuad(snakeRects[3 * snakeColumns + 0], fruitX, fruitY));
+    addSnake();
+    drawFrameQuads();
   }
 
   glutSwapBuffers();
+  frameDirty = false;
 }
 
 void resetGame()
@@ -656,6 +549,27 @@ void resetGame()
   placeFruit();
 }
 
+// The timer only runs while the snake moves, so a paused or finished game
+// sits idle instead of repainting every frame
+bool timerArmed = false;
+
+void update(int);
+
+void armTimer()
+{
+  if (timerArmed || snakeDirection == NONE || isGameOver)
+    return;
+  timerArmed = true;
+  glutTimerFunc(1000 / frame_rate, update, 0);
+}
+
+void markDirty()
+{
+  if (!frameDirty)
+    glutPostRedisplay();
+  frameDirty = true;
+}
+
 void keyboard(unsigned char key, int, int)
 {
   if (key == 'a' && snakeDirection != RIGHT)
@@ -669,7 +583,11 @@ void keyboard(unsigned char key, int, int)
   if (key == ' ' && snakeDirection != NONE && !isGameOver)
     snakeDirection = NONE;
   if (key == ' ' && isGameOver)
+  {
     resetGame();
+    markDirty();
+  }
+  armTimer();
 }
 
 void specialKeyboard(int key, int, int)
@@ -682,6 +600,13 @@ void specialKeyboard(int key, int, int)
     snakeDirection = UP;
   if (key == GLUT_KEY_DOWN && snakeDirection != UP)
     snakeDirection = DOWN;
+  armTimer();
+}
+
+void reshape(int width, int height)
+{
+  glViewport(0, 0, width, height);
+  markDirty();
 }
 
 std::chrono::steady_clock::time_point lastMoveTime = std::chrono::steady_clock::now();
@@ -692,6 +617,7 @@ const std::chrono::milliseconds moveSoundInterval(300);
 
 void update(int)
 {
+  timerArmed = false;
   auto currentTime = std::chrono::steady_clock::now();
   bool movementIntervalMet = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastMoveTime) >= moveInterval;
   bool movementSoundIntervalMet = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastMoveSoundTime) >= moveSoundInterval;
@@ -710,9 +636,9 @@ void update(int)
       musicPlayed = true;
     }
     lastMoveTime = currentTime;
+    markDirty();
   }
-  glutPostRedisplay();
-  glutTimerFunc(1000 / frame_rate, update, 0);
+  armTimer();
 }
 
 int main(int argc, char **argv)
@@ -723,6 +649,22 @@ int main(int argc, char **argv)
   glutCreateWindow("Snake Game");
 
   program = createProgram();
+  posLoc = glGetAttribLocation(program, "aPosition");
+  texLoc = glGetAttribLocation(program, "aTexCoord");
+  atlasTexture = loadTexture(atlasTexturePath);
+  glGenBuffers(1, &frameBuffer);
+
+  // The whole frame is white-tinted atlas sprites, set up the state once
+  glUseProgram(program);
+  glBindTexture(GL_TEXTURE_2D, atlasTexture);
+  glUniform1i(glGetUniformLocation(program, "uUseFontTexture"), 1);
+  glUniform1i(glGetUniformLocation(program, "uUseTexture"), 0);
+  glUniform3f(glGetUniformLocation(program, "uColor"), 1.0f, 1.0f, 1.0f);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  gameOverText.build("GAME OVER!", 0.0f, 0.7f, 0.13f, true);
+  restartText.build("\"SPACE\" TO RESTART", 0.0f, 0.48f, 0.08f, true);
   placeFruit();
   snakeWidth = 4.0f / columns;
   snakeHeight = 4.0f / rows;
@@ -731,7 +673,7 @@ int main(int argc, char **argv)
   glutDisplayFunc(display);
   glutKeyboardFunc(keyboard);
   glutSpecialFunc(specialKeyboard);
-  glutTimerFunc(1000 / frame_rate, update, 0);
+  glutReshapeFunc(reshape);
 
   glutMainLoop();
   return 0;